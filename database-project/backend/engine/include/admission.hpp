@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <nlohmann/json.hpp>
+
+// Process-wide cap on requests that were accepted but not yet answered.
+// limit: default 4096, can be overridden with env ENGINE_MAX_INFLIGHT (0 = no cap)
+class Admission {
+public:
+    static bool tryEnter();
+    static void leave();
+
+    static size_t inFlight();
+    static size_t limit();
+    static uint64_t rejected();
+
+    // fast reply for shed requests; requestId is echoed when known
+    static nlohmann::json busyResponse(const nlohmann::json& requestId);
+};
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Bloom filter over SST keys, sized by bits per key (LSM_BLOOM_BITS_PER_KEY,
+// default 10, about 1% false positives). k = bitsPerKey * ln 2 probes are
+// derived from one 64-bit hash by double hashing: h1 + i * h2.
+//
+// Serialized form (kept in the SST meta block):
+//   [hashes u32][bits u64][bit array, bits / 8 bytes]
+class BloomFilter {
+public:
+    // filter for `keys` hashes, empty until add()
+    explicit BloomFilter(size_t keys, double bitsPerKey = defaultBitsPerKey());
+
+    // stable across builds and platforms: the hash is stored on disk
+    static uint64_t hash(const std::string& key);
+
+    void add(uint64_t h);
+    bool mayContain(uint64_t h) const;
+    bool mayContain(const std::string& key) const { return mayContain(hash(key)); }
+
+    std::string serialize() const;
+    // nullptr if the bytes are not a filter
+    static std::shared_ptr<BloomFilter> deserialize(const std::string& bytes);
+
+    size_t bitCount() const { return bits.size() * 64; }
+    uint32_t hashCount() const { return hashes; }
+    size_t memoryBytes() const { return bits.size() * sizeof(uint64_t); }
+
+    // (1 - e^(-k n / m))^k for n keys
+    double expectedFpRate(size_t keys) const;
+
+    static double defaultBitsPerKey();
+
+private:
+    BloomFilter() = default;
+
+    std::vector<uint64_t> bits;
+    uint32_t hashes = 1;
+};
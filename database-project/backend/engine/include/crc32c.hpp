@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// CRC32C (Castagnoli) used to checksum WAL and storage records.
+// Uses the SSE4.2 crc32 instruction when the CPU has it, a table-driven
+// software version otherwise; both give the same values.
+class CRC32C {
+public:
+    // extend `crc` (0 to start) with len bytes
+    static uint32_t extend(uint32_t crc, const void* data, size_t len);
+    static uint32_t compute(const void* data, size_t len) { return extend(0, data, len); }
+
+    // portable version, always available (the benchmark compares both)
+    static uint32_t extendSoftware(uint32_t crc, const void* data, size_t len);
+
+    static bool hardware();
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include "database_engine.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Open find cursors, addressed by id across requests (and connections).
+// Idle cursors are dropped after ENGINE_CURSOR_TIMEOUT_MS (default 600000);
+// at most ENGINE_MAX_CURSORS (default 1024) stay open at once.
+class CursorRegistry {
+public:
+    // returns 0 when the cursor limit is reached
+    static uint64_t open(std::unique_ptr<FindCursor> cursor);
+
+    // next batch of an open cursor; false if the id is unknown or expired.
+    // An exhausted cursor is closed and `exhausted` is set.
+    static bool next(uint64_t id, size_t batchSize, std::vector<json>& out, bool& exhausted);
+
+    static bool close(uint64_t id);
+    static size_t openCount();
+};
@@ -1,5 +1,7 @@
 #pragma once
+#include "doc_stream.hpp"
 #include <nlohmann/json.hpp>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -7,6 +9,23 @@ using json = nlohmann::json;
 
 struct QueryNode;
 
+// Streaming result of a find: the scan state (open SST readers, parsed
+// filter) lives here and matches are produced batch by batch.
+class FindCursor {
+public:
+    FindCursor(std::unique_ptr<DocStream> source, const json& filter);
+    ~FindCursor();
+
+    // append up to `limit` matches to out; returns how many were added
+    size_t nextBatch(size_t limit, std::vector<json>& out);
+    bool exhausted() const { return done; }
+
+private:
+    std::unique_ptr<DocStream> source;
+    std::unique_ptr<QueryNode> query;   // null = match everything
+    bool done = false;
+};
+
 class DatabaseEngine {
 public:
     static void init(const std::string& rootPath);
@@ -17,6 +36,7 @@ public:
     static void insert(const std::string& userId, const std::string& dbName, const std::string& collection, const json& doc);
     static void insertVector(const std::string& userId, const std::string& dbName, const std::string& collection, const json& doc);
     static std::vector<json> find(const std::string& userId, const std::string& dbName, const std::string& collection, const json& filter);
+    static std::unique_ptr<FindCursor> openFind(const std::string& userId, const std::string& dbName, const std::string& collection, const json& filter);
     static std::vector<json> queryVector(const std::string& userId, const std::string& dbName, const std::string& collection, const json& query);
     static bool updateOne(const std::string& userId, const std::string& dbName, const std::string& collection, const json& filter, const json& update);
     static bool deleteOne(const std::string& userId, const std::string& dbName, const std::string& collection, const json& filter);
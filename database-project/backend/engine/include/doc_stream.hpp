@@ -0,0 +1,31 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Pull-based source of documents. Implementations keep their read state
+// (open files, positions) between calls instead of building a vector.
+class DocStream {
+public:
+    virtual ~DocStream() = default;
+
+    // next document, false once exhausted
+    virtual bool next(json& doc) = 0;
+};
+
+// DocStream over documents that are already in memory
+class VectorDocStream : public DocStream {
+public:
+    explicit VectorDocStream(std::vector<json> docs) : docs(std::move(docs)) {}
+
+    bool next(json& doc) override {
+        if (pos >= docs.size()) return false;
+        doc = std::move(docs[pos++]);
+        return true;
+    }
+
+private:
+    std::vector<json> docs;
+    size_t pos = 0;
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include "worker_pool.hpp"
+#include "session.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Linux epoll reactor. One thread owns every socket (listeners and clients),
+// does all non-blocking reads/writes, cuts complete requests out of the byte
+// stream (see protocol.hpp) and hands them to the worker pool (framed
+// connections go through their Session). Workers hand their responses back
+// through post(); every request produces exactly one post().
+class EventLoop {
+public:
+    // legacy connections: turns the request text into the response text (runs on a worker)
+    using RequestHandler = std::function<std::string(const std::string&)>;
+
+    EventLoop(WorkerPool& pool, RequestHandler handler);
+    ~EventLoop();
+
+    // register a bound + listening socket (TCP or unix domain); it is
+    // switched to non-blocking
+    void addListener(int fd);
+
+    // blocking reactor loop
+    void run();
+
+    // thread-safe: queue bytes for a connection and wake the reactor
+    void post(uint64_t connId, std::string bytes, bool closeAfterWrite);
+
+private:
+    enum class Mode { UNKNOWN, LEGACY, FRAMED };
+
+    struct Connection {
+        int fd = -1;
+        uint64_t id = 0;
+        Mode mode = Mode::UNKNOWN;
+        std::string in;
+        size_t inPos = 0;             // consumed prefix of `in`
+        std::string out;
+        std::shared_ptr<Session> session;   // framed connections only
+        size_t inFlight = 0;          // requests handed to workers, not yet answered
+        uint32_t events = 0;          // epoll interest currently registered
+        bool peerClosed = false;      // read side hit EOF
+        bool closeAfterWrite = false;
+    };
+
+    struct Completion {
+        uint64_t connId;
+        std::string bytes;
+        bool closeAfterWrite;
+    };
+
+    void acceptAll(int listenFd);
+    void onReadable(Connection& c);
+    void onWritable(Connection& c);
+    void processInput(Connection& c);
+    bool readPaused(const Connection& c) const;
+    void drainCompletions();
+    void dispatchLegacy(Connection& c, std::string payload);
+    void updateInterest(Connection& c);
+    void closeConnection(int fd);
+
+    WorkerPool& pool;
+    RequestHandler handler;
+
+    int epfd = -1;
+    int wakefd = -1;
+    std::vector<int> listeners;
+
+    uint64_t nextConnId = 1;
+    std::unordered_map<int, Connection> conns;      // fd -> connection
+    std::unordered_map<uint64_t, int> connFds;      // id -> fd (fds get reused, ids do not)
+
+    std::mutex completionMutex;
+    std::vector<Completion> completions;
+};
@@ -1,5 +1,7 @@
 #pragma once
+#include "doc_stream.hpp"
 #include <nlohmann/json.hpp>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -10,18 +12,71 @@ public:
     // initialize with engine data root
     static void init(const std::string& rootPath);
 
-    // put document into memtable (and WAL) and schedule flush
+    // startup recovery: replay every collection WAL under the data root
+    // into its memtable (PUT and DELETE, nothing is logged again), several
+    // collections at a time. Call after init, before serving requests.
+    // Returns per-collection records, time and records/s plus totals.
+    static json recover();
+
+    // put document into memtable (and WAL); concurrent writers of one
+    // collection are coalesced into a single batch. A full memtable is set
+    // aside as immutable (still read) and written to an SST by a background
+    // flusher; writers only stall once LSM_MAX_IMMUTABLE_MEMTABLES wait.
     static void put(const std::string& userId,
                     const std::string& dbName,
                     const std::string& collection,
                     const json& doc);
 
-    // read all documents (merge memtable + SST files)
+    // Change stream: committed PUT / DELETE events read from the collection
+    // WAL, numbered after resumeAfter, at most `limit` of them. Without a
+    // token the stream starts at the current end. With an empty collection
+    // the whole database is watched and the token is an object of
+    // per-collection numbers. When nothing is there yet, waits up to
+    // maxAwaitMs (capped by LSM_WATCH_MAX_AWAIT_MS) for a commit.
+    // Returns { events, resumeToken } or an error once the WAL was
+    // checkpointed past the token.
+    static json watch(const std::string& userId,
+                      const std::string& dbName,
+                      const std::string& collection,
+                      const json& resumeAfter,
+                      size_t limit,
+                      long maxAwaitMs);
+
+    // WAL shipping, leader side: watch() over every collection under the
+    // data root. resumeAfter maps "user/db/collection" to the last number
+    // applied; collections missing from it, or checkpointed past it, come
+    // back in "resync" (the follower copies them with find first). Also
+    // returns "heads", the committed end of each WAL, for lag reporting.
+    static json replicate(const json& resumeAfter, size_t limit, long maxAwaitMs);
+
+    // coalesced write counters: batches applied, writes applied, average
+    // batch size; memtables waiting for flush, flushes done, write stalls
+    static json writeStats();
+
+    // point read by id: memtable first, then SSTs newest to oldest, skipping
+    // files whose bloom filter rules the id out. Stops at the first version
+    // found; false if there is none or it is a tombstone.
+    static bool get(const std::string& userId,
+                    const std::string& dbName,
+                    const std::string& collection,
+                    const std::string& id,
+                    json& out);
+
+    // read all live documents: scan() drained into a vector
     static std::vector<json> getAll(const std::string& userId,
                                     const std::string& dbName,
                                     const std::string& collection);
 
-    // force a flush for a specific collection (debug)
+    // stream the live documents in id order without loading them up front:
+    // a k-way merge of the memtable and SST files yielding only the newest
+    // version of each id, tombstones dropped. SST files are opened when the
+    // stream is created, the memtable is snapshotted
+    static std::unique_ptr<DocStream> scan(const std::string& userId,
+                                           const std::string& dbName,
+                                           const std::string& collection);
+
+    // force a flush for a specific collection (debug); returns once the
+    // memtable and any immutable ones before it are in SSTs
     static void flush(const std::string& userId,
                       const std::string& dbName,
                       const std::string& collection);
@@ -32,9 +87,12 @@ public:
                         const std::string& dbName,
                         const std::string& collection);
 
-    // Bloom filter support (adaptive)
+    // Bloom filters, bits-per-key sized, held in memory per SST
+    // load the SST's filter (build one for a legacy text SST) into memory
     static void buildBloomForSST(const std::string& sstPath);
     static bool mayExistInSST(const std::string& sstPath, const std::string& key);
+    // loaded filters, their memory, probes and measured false-positive rate
+    static json bloomStats();
 
     // Columnar secondary index scaffold
     static void updateColumnIndexes(const std::string& userId,
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <nlohmann/json.hpp>
+
+// Wire format shared by every network front end.
+//
+//   framed : [uint32 big-endian payload length][payload], repeated; the
+//            connection stays open across requests
+//   legacy : a bare JSON document starting with '{'; one response, then close
+//
+// Frame payloads are JSON text unless the connection opened with a hello
+// frame choosing a binary encoding:
+//   {"action":"hello","encoding":"msgpack"|"cbor"|"json"}
+// The hello itself and its reply are JSON text; every later frame in both
+// directions uses the chosen encoding.
+class Protocol {
+public:
+    enum class FrameStatus { NEED_MORE, READY, TOO_LARGE };
+    enum class Encoding { JSON, MSGPACK, CBOR };
+
+    static const size_t HEADER_SIZE = 4;
+
+    // largest accepted payload: default 256 MiB, can be overridden with env ENGINE_MAX_FRAME
+    static size_t maxFrameSize();
+
+    // first byte of a connection decides framed vs legacy
+    static bool isLegacyStart(char first);
+
+    // payload length carried by a HEADER_SIZE-byte header
+    static size_t decodeHeader(const unsigned char* header);
+
+    static void appendFrame(std::string& out, const std::string& payload);
+    static std::string encodeFrame(const std::string& payload);
+
+    // cut the next frame out of buf starting at pos; on READY pos moves past it
+    static FrameStatus nextFrame(const std::string& buf, size_t& pos, std::string& payload);
+
+    static bool parseEncoding(const std::string& name, Encoding& out);
+    static const char* encodingName(Encoding enc);
+    static nlohmann::json::input_format_t inputFormat(Encoding enc);
+
+    // payload <-> document; decode yields a discarded value on malformed input
+    static std::string encode(const nlohmann::json& doc, Encoding enc);
+    static nlohmann::json decode(const std::string& payload, Encoding enc);
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+#include <nlohmann/json.hpp>
+
+// WAL shipping, follower side. A process started with ENGINE_FOLLOW set to
+// the leader's address ("host:port", or a unix socket path) serves reads
+// only: a background thread long-polls the leader's "replicate" action and
+// applies the PUT / DELETE records to its own memtables, WALs and SSTs.
+// Collections the follower has no position for (new ones, or ones the
+// leader checkpointed past) are copied with find first. Applied positions
+// survive restarts in <data root>/replication.json.
+class Replication {
+public:
+    static void startFollower(const std::string& leader, const std::string& dataRoot);
+
+    static bool isFollower();
+
+    // leader, connection state, applied records, lag in records and ms
+    static nlohmann::json stats();
+};
@@ -1,4 +1,12 @@
 #pragma once
+#include <nlohmann/json.hpp>
 
 void startServer();
+
+// run one decoded request against the engine and build its response;
+// never throws (a discarded/invalid document yields an error response)
+nlohmann::json handleRequest(const nlohmann::json& req);
+
+#ifdef _WIN32
 void handleClient(unsigned long long clientSocket);
+#endif
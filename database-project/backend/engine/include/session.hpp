@@ -0,0 +1,61 @@
+#pragma once
+#include "worker_pool.hpp"
+#include "protocol.hpp"
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+// Request state of one framed connection, shared by the network front ends.
+//
+// Frames are handed over in arrival order and run on the worker pool.
+// A request carrying "requestId" runs as soon as a worker is free and its
+// response echoes the same requestId, so responses may come back out of
+// order. Requests without a requestId keep the old contract: they run one
+// at a time, in the order they arrived, relative to each other.
+//
+// Every frame passes admission control first (Admission + the pool's
+// bounded queue); a refused frame gets an immediate "busy" reply.
+//
+// The first frame may be a hello choosing the connection's encoding
+// (see protocol.hpp); it is answered inline by the front end thread.
+class Session : public std::enable_shared_from_this<Session> {
+public:
+    // thread-safe sink for one encoded response frame
+    using Writer = std::function<void(std::string frame)>;
+
+    Session(WorkerPool& pool, Writer writer);
+
+    // front end thread only, one call per received frame payload
+    void onFrame(std::string payload);
+
+private:
+    struct Parked {
+        nlohmann::json req;
+        bool shed = false;                // refused at admission: reply "busy"
+    };
+
+    bool handshake(const std::string& payload);
+    void shed(uint64_t seq, const std::string& payload);
+    void run(uint64_t seq, const std::string& payload);
+    void respond(const nlohmann::json& req, nlohmann::json res);
+    void release(uint64_t seq);
+    void releaseLocked(uint64_t seq);
+    void drainOrdered();
+
+    WorkerPool& pool;
+    Writer writer;
+
+    uint64_t nextArrival = 0;             // front end thread only
+    // set by the hello frame before any request reaches the pool
+    Protocol::Encoding encoding = Protocol::Encoding::JSON;
+
+    std::mutex laneMutex;
+    uint64_t nextSeq = 0;                 // every seq below this is released
+    std::set<uint64_t> releasedAhead;     // released out of order, above nextSeq
+    std::map<uint64_t, Parked> parked;    // untagged requests waiting their turn
+};
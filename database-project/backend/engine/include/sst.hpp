@@ -0,0 +1,116 @@
+#pragma once
+#include "bloom.hpp"
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+// Block-based sorted table.
+//
+//   [data block]...[index block][meta block][footer]
+//
+// Data blocks hold entries in ascending key order, cut at SST_BLOCK_BYTES
+// (default 4096): [flags u8][key len u32][key][value len u32][value], the
+// value being the MessagePack document (a tombstone stores none). Every
+// block ends with its CRC32C. The index block holds one entry per data
+// block: its last key, offset and size. The optional meta block is a
+// MessagePack object with table-wide data; the writer adds "bloom", the
+// serialized BloomFilter over all keys. The fixed-size footer locates
+// both and carries the entry count, format version and magic number.
+//
+// Files written before this format are newline-delimited JSON; the reader
+// still streams them (no sorting, no point reads).
+class SSTWriter {
+public:
+    explicit SSTWriter(const std::string& path);
+
+    bool ok() const { return !failed; }
+
+    // keys must come in strictly ascending order; a document with
+    // "_deleted": true is stored as a tombstone
+    void add(const std::string& key, const json& doc);
+
+    // table-wide data for the meta block
+    void setMeta(json meta) { this->meta = std::move(meta); }
+
+    // write the last block, index, meta block and footer; false on any
+    // write error
+    bool finish();
+
+    uint64_t entries() const { return count; }
+
+    // the key filter written by finish()
+    std::shared_ptr<const BloomFilter> filter() const { return bloom; }
+
+private:
+    void flushBlock();
+    void write(const std::string& bytes);
+
+    std::string file;
+    std::ofstream out;
+    std::string block;
+    std::string blockLastKey;
+    std::string index;
+    uint32_t blocks = 0;
+    uint64_t offset = 0;
+    uint64_t count = 0;
+    json meta;
+    std::vector<uint64_t> keyHashes;
+    std::shared_ptr<const BloomFilter> bloom;
+    bool failed = false;
+};
+
+class SSTReader {
+public:
+    // nullptr if the file cannot be opened or is neither format (e.g. a
+    // block table cut short by a crash)
+    static std::unique_ptr<SSTReader> open(const std::string& path);
+
+    bool blockBased() const { return version != 0; }
+    uint64_t entries() const { return count; }
+    const json& meta() const { return metaDoc; }
+    const std::string& path() const { return file; }
+
+    // key filter from the meta block; nullptr for tables without one
+    std::shared_ptr<const BloomFilter> filter() const { return bloom; }
+
+    // point read: one index search and one block read; false if absent.
+    // A tombstone is returned as {"id": key, "_deleted": true}.
+    // Resets the iteration below.
+    bool get(const std::string& key, json& doc);
+
+    // position the iteration at the first key >= key (legacy: the start)
+    void seek(const std::string& key);
+
+    // next entry in key order (legacy: file order, key from "id")
+    bool next(std::string& key, json& doc);
+
+private:
+    struct IndexEntry {
+        std::string lastKey;
+        uint64_t offset;
+        uint32_t size;
+    };
+
+    SSTReader() = default;
+    bool loadBlock(size_t i);
+    bool nextInBlock(std::string& key, json* doc);
+
+    std::string file;
+    std::ifstream in;
+    uint32_t version = 0;
+    uint64_t count = 0;
+    json metaDoc;
+    std::shared_ptr<const BloomFilter> bloom;
+    std::vector<IndexEntry> index;
+
+    // iteration state
+    size_t blockNo = 0;
+    std::string blockData;
+    size_t pos = 0;
+    bool loaded = false;
+};
@@ -1,21 +1,212 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 enum class WalOp : uint8_t {
     INSERT = 1,
     UPDATE = 2,
-    DELETE = 3
+    DELETE = 3,
+    CHECKPOINT = 4      // everything in older segments is persisted elsewhere
+};
+
+// One write of a collection WAL (WalWriter::logWrites). Only what changed
+// is logged - the document or the key; user, db and collection are implied
+// by the file. Nothing is copied.
+struct WalWrite {
+    WalOp op = WalOp::INSERT;
+    const nlohmann::json* doc = nullptr;    // INSERT / UPDATE
+    const std::string* key = nullptr;       // DELETE
+};
+
+// One record read back from a WAL.
+struct WalRecord {
+    WalOp op = WalOp::INSERT;
+    uint64_t seq = 0;           // 0: written before records were numbered
+    bool entry = false;         // doc is a whole entry as given to WAL::log
+    nlohmann::json doc;         // INSERT/UPDATE document, CHECKPOINT info, or the entry
+    std::string key;            // DELETE: id of the removed document
+};
+
+// When a record counts as committed (env WAL_SYNC):
+//   none     - written to the file, left to the OS page cache
+//   batch    - fdatasync before the committers return (default)
+//   interval - written now, synced in the background every
+//              WAL_SYNC_INTERVAL_MS milliseconds (default 100)
+enum class WalSync {
+    NONE,
+    BATCH,
+    INTERVAL
+};
+
+// Long-lived writer of one WAL file, shared by everyone appending to it.
+//
+// Appends go through a bounded multi-producer ring of WAL_RING_SLOTS
+// record slots (default 4096). A producer claims a run of slots with one
+// atomic add - the slot ticket is the record's sequence number - encodes
+// and checksums its records into them and publishes each slot, all
+// without a lock. One flusher thread per writer drains the published
+// slots in order and writes each contiguous run with a single write()
+// and, under the batch policy, a single sync. WAL_GROUP_COMMIT_US
+// (default 0) lets it wait a little for more records first. A producer
+// only blocks if the ring is full or when it waits for durability.
+//
+// The flusher keeps the descriptor open, does the interval-policy syncs
+// and closes the file once it has been idle for WAL_IDLE_CLOSE_MS
+// (default 30000). The writer object itself stays valid, so callers may
+// cache it.
+//
+// A WAL is a series of segments next to its nominal path: "c.wal" is
+// written as "c.000001.wal", "c.000002.wal", ... A segment is closed once
+// it reaches WAL_SEGMENT_BYTES (default 64 MiB); a checkpoint record
+// always starts a new one. A pre-segment "c.wal" still counts as segment 0.
+class WalWriter {
+public:
+    explicit WalWriter(std::string file);
+    ~WalWriter();
+
+    // Queue records and return the sequence number of the last one right
+    // away; waitDurable() blocks until it is committed under the sync
+    // policy. Numbers grow by one per record across the segments of a WAL.
+    uint64_t appendWrites(const std::vector<WalWrite>& writes);
+    void waitDurable(uint64_t seq);
+
+    // append + wait: return once committed, with the last sequence number
+    uint64_t logWrites(const std::vector<WalWrite>& writes);
+
+    // self-describing entries (user, db, collection inside), e.g. db.wal
+    uint64_t log(const nlohmann::json& entry);
+    uint64_t logBatch(const std::vector<nlohmann::json>& entries);
+
+    // Write a CHECKPOINT record at the head of a new segment and retire
+    // every older segment: whatever they held is persisted elsewhere (e.g.
+    // flushed to an SST). Retired segments are deleted or kept to be
+    // written over by later segments (WAL_RECYCLE_SEGMENTS). The caller
+    // must make sure no record it still depends on is queued concurrently.
+    // Returns the record's number.
+    uint64_t checkpoint(const nlohmann::json& info);
+
+    // Two-step checkpoint for data persisted in the background: rotate()
+    // starts a new segment for the records after it and retires nothing;
+    // checkpoint(info, rotation) later writes a CHECKPOINT record and
+    // retires the segments before the one that rotation started. Neither
+    // waits for the sync. Both records are CHECKPOINTs to readers.
+    uint64_t rotate();
+    uint64_t checkpoint(const nlohmann::json& info, uint64_t rotation);
+
+    uint64_t lastSeq() const { return baseSeq + reserved.load(); }
+    // every record up to this number is committed (readable by WAL::read)
+    uint64_t durableSeq() const { return baseSeq + durable.load(); }
+    const std::string& path() const { return file; }
+
+private:
+    friend class WAL;
+    using Clock = std::chrono::steady_clock;
+
+    struct Slot {
+        std::atomic<uint64_t> turn{0};  // == ticket: free for it, == ticket + 1: published
+        std::string bytes;              // encoded record
+        bool startsSegment = false;     // checkpoint: write into a fresh segment
+        uint64_t retireBefore = 0;      // retire the segments before the one this record number started
+    };
+
+    // encoder(slot bytes, seq) fills one record; returns the last ticket.
+    // retireBefore goes into every slot, RETIRE_OWN for the record's own number
+    static constexpr uint64_t RETIRE_OWN = ~0ull;
+    uint64_t publish(size_t count, const std::function<bool(size_t, std::string&, uint64_t)>& encode,
+                     uint64_t retireBefore = 0);
+    void flusherLoop();
+    void openSegment();                 // flusher only
+    void closeSegment();                // flusher only
+    bool writeRun();                    // flusher only
+    void scanSegments();
+    std::string segmentPath(uint64_t seq, const char* ext = ".wal") const;
+
+    const std::string file;
+
+    std::vector<Slot> ring;
+    uint64_t mask = 0;
+    std::atomic<uint64_t> reserved{0};  // tickets handed out
+    std::atomic<uint64_t> durable{0};   // every ticket below is committed
+    uint64_t baseSeq = 0;               // last sequence number on disk at start
+
+    // flusher sleep / producer wake-up, durability waits
+    std::mutex m;
+    std::condition_variable wake;
+    std::condition_variable durableCv;
+    std::atomic<bool> sleeping{false};
+    std::atomic<int> waiters{0};
+    std::thread flusher;
+    std::atomic<bool> stopping{false};
+
+    // flusher-owned state
+    int fd = -1;
+    uint64_t segment = 1;               // segment written to
+    uint64_t segmentBytes = 0;          // end of the records in it (the file may be longer)
+    std::vector<std::pair<uint64_t, uint64_t>> rotations;   // record number -> segment it started
+    bool dirty = false;                 // written but not synced (interval policy)
+    bool dsync = false;                 // descriptor is O_DSYNC: writes are durable
+    bool direct = false;                // descriptor is O_DIRECT: aligned writes only
+    std::string tail;                   // O_DIRECT: written part of the last block
+    char* block = nullptr;              // O_DIRECT: aligned write buffer
+    size_t blockCap = 0;
+    Clock::time_point lastUsed = Clock::now();
+    Clock::time_point lastSync = Clock::now();
+    std::string out;                    // run being written, keeps its capacity
 };
 
 class WAL {
 public:
+    // shared writer for a WAL file, created on first use
+    static std::shared_ptr<WalWriter> writer(const std::string& file);
+
     static void log(const std::string& file,
                     const nlohmann::json& entry);
 
+    static void logBatch(const std::string& file,
+                         const std::vector<nlohmann::json>& entries);
+
+    static WalSync syncPolicy();
+
+    // group commit counters: groups, records, batch size, commit latency,
+    // syncs, open descriptors; I/O mode, preallocated and recycled segments
+    static nlohmann::json stats();
+
+    // segment files of a WAL, oldest first (a pre-segment file comes first)
+    static std::vector<std::string> segments(const std::string& file);
+
+    // every record across all segments, oldest first; stops (and returns
+    // false) at the first record that is cut short or fails its checksum.
+    // With `after`, only records numbered after it are decoded and passed on.
+    static bool read(const std::string& file, const std::function<void(WalRecord&)>& fn,
+                     uint64_t after = 0);
+
+    // change stream wake-ups: the epoch moves on after every commit of any
+    // WAL; waitCommit() returns true once it differs from `epoch`, false on
+    // timeout
+    static uint64_t commitEpoch();
+    static bool waitCommit(uint64_t epoch, std::chrono::milliseconds timeout);
+
+    // every data record across all segments, as JSON text
                      static std::vector<std::string>
     readAll(const std::string& walFile);
 
+    // re-inserts the self-describing INSERT entries of a WAL through the
+    // engine; startup recovery of collection WALs is LSM::recover()
     static void replay(const std::string& file);
+
+    // drop every record of a WAL: a checkpoint without data behind it
+    // (sequence numbers keep growing)
     static void clear(const std::string& file);
+
+    // make a finished file durable (e.g. an SST before its checkpoint)
+    static bool syncPath(const std::string& path);
 };
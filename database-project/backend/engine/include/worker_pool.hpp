@@ -0,0 +1,73 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads that run request handlers handed over by the
+// network front end. Sockets never leave the front end; only work does.
+//
+// The queue can be bounded: trySubmit() refuses work once maxQueue tasks
+// are waiting so callers can shed load instead of piling it up. submit()
+// always enqueues and is meant for follow-up work of already admitted
+// requests.
+class WorkerPool {
+public:
+    struct Stats {
+        size_t threads = 0;
+        size_t queued = 0;          // waiting right now
+        size_t peakQueued = 0;
+        size_t active = 0;          // running right now
+        size_t maxQueue = 0;        // 0 = unbounded
+        uint64_t completed = 0;
+        uint64_t rejected = 0;
+        double avgWaitMs = 0.0;     // enqueue -> start, over all started tasks
+        double maxWaitMs = 0.0;
+    };
+
+    explicit WorkerPool(size_t threads, size_t maxQueue = 0);
+    ~WorkerPool();
+
+    void submit(std::function<void()> task);
+    bool trySubmit(std::function<void()> task);
+    void stop();
+
+    // run fn(0..count-1) spread over the pool and return when all are done.
+    // The calling thread takes items too, so a pool task may use this
+    // without deadlocking even when every other worker is busy. The first
+    // exception thrown by fn is rethrown here.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+    size_t size() const { return workers.size(); }
+    Stats stats();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Task {
+        std::function<void()> fn;
+        Clock::time_point enqueued;
+    };
+
+    void workerLoop();
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<Task> tasks;
+    std::vector<std::thread> workers;
+    size_t maxQueue = 0;
+    bool stopping = false;
+
+    // stats, guarded by mtx
+    size_t peakQueued = 0;
+    size_t active = 0;
+    uint64_t started = 0;
+    uint64_t completed = 0;
+    uint64_t rejected = 0;
+    double totalWaitMs = 0.0;
+    double maxWaitMs = 0.0;
+};
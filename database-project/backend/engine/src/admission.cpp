@@ -0,0 +1,39 @@
+#include "admission.hpp"
+#include <atomic>
+#include <cstdlib>
+
+static const size_t MAX_INFLIGHT = []() {
+    const char* v = std::getenv("ENGINE_MAX_INFLIGHT");
+    if (v) {
+        try { return static_cast<size_t>(std::stoull(v)); } catch (...) { }
+    }
+    return static_cast<size_t>(4096);
+}();
+
+static std::atomic<size_t> inFlightCount(0);
+static std::atomic<uint64_t> rejectedCount(0);
+
+bool Admission::tryEnter() {
+    size_t cur = inFlightCount.load(std::memory_order_relaxed);
+    do {
+        if (MAX_INFLIGHT && cur >= MAX_INFLIGHT) {
+            rejectedCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    } while (!inFlightCount.compare_exchange_weak(cur, cur + 1, std::memory_order_relaxed));
+    return true;
+}
+
+void Admission::leave() {
+    inFlightCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+size_t Admission::inFlight() { return inFlightCount.load(std::memory_order_relaxed); }
+size_t Admission::limit() { return MAX_INFLIGHT; }
+uint64_t Admission::rejected() { return rejectedCount.load(std::memory_order_relaxed); }
+
+nlohmann::json Admission::busyResponse(const nlohmann::json& requestId) {
+    nlohmann::json res = { {"status", "busy"}, {"error", "server busy, retry later"} };
+    if (!requestId.is_null()) res["requestId"] = requestId;
+    return res;
+}
@@ -0,0 +1,85 @@
+#include "bloom.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+double BloomFilter::defaultBitsPerKey() {
+    static const double bpk = []() {
+        const char* v = std::getenv("LSM_BLOOM_BITS_PER_KEY");
+        double n = v ? std::atof(v) : 10.0;
+        return n >= 1.0 && n <= 64.0 ? n : 10.0;
+    }();
+    return bpk;
+}
+
+BloomFilter::BloomFilter(size_t keys, double bitsPerKey) {
+    // at least one word; a small table would otherwise fill up
+    size_t want = static_cast<size_t>(std::ceil(std::max<size_t>(keys, 1) * bitsPerKey));
+    bits.assign((std::max<size_t>(want, 64) + 63) / 64, 0);
+    hashes = static_cast<uint32_t>(std::clamp(std::lround(bitsPerKey * 0.69314718), 1L, 30L));
+}
+
+// FNV-1a, then the splitmix64 finalizer so both halves are well mixed
+uint64_t BloomFilter::hash(const std::string& key) {
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27; h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+void BloomFilter::add(uint64_t h) {
+    const uint64_t m = bitCount();
+    const uint64_t h1 = h & 0xffffffffull;
+    const uint64_t h2 = (h >> 32) | 1;   // odd step, never stuck on one bit
+    for (uint32_t i = 0; i < hashes; ++i) {
+        uint64_t bit = (h1 + i * h2) % m;
+        bits[bit / 64] |= 1ull << (bit % 64);
+    }
+}
+
+bool BloomFilter::mayContain(uint64_t h) const {
+    const uint64_t m = bitCount();
+    const uint64_t h1 = h & 0xffffffffull;
+    const uint64_t h2 = (h >> 32) | 1;
+    for (uint32_t i = 0; i < hashes; ++i) {
+        uint64_t bit = (h1 + i * h2) % m;
+        if (!(bits[bit / 64] & (1ull << (bit % 64)))) return false;
+    }
+    return true;
+}
+
+double BloomFilter::expectedFpRate(size_t keys) const {
+    double m = static_cast<double>(bitCount());
+    return std::pow(1.0 - std::exp(-static_cast<double>(hashes) * keys / m), hashes);
+}
+
+std::string BloomFilter::serialize() const {
+    uint64_t m = bitCount();
+    std::string out(sizeof(hashes) + sizeof(m) + memoryBytes(), '\0');
+    std::memcpy(&out[0], &hashes, sizeof(hashes));
+    std::memcpy(&out[sizeof(hashes)], &m, sizeof(m));
+    std::memcpy(&out[sizeof(hashes) + sizeof(m)], bits.data(), memoryBytes());
+    return out;
+}
+
+std::shared_ptr<BloomFilter> BloomFilter::deserialize(const std::string& bytes) {
+    uint32_t k = 0;
+    uint64_t m = 0;
+    if (bytes.size() < sizeof(k) + sizeof(m)) return nullptr;
+    std::memcpy(&k, bytes.data(), sizeof(k));
+    std::memcpy(&m, bytes.data() + sizeof(k), sizeof(m));
+    if (k == 0 || k > 30 || m == 0 || m % 64 != 0 || bytes.size() != sizeof(k) + sizeof(m) + m / 8) return nullptr;
+
+    std::shared_ptr<BloomFilter> out(new BloomFilter());
+    out->hashes = k;
+    out->bits.assign(m / 64, 0);
+    std::memcpy(out->bits.data(), bytes.data() + sizeof(k) + sizeof(m), m / 8);
+    return out;
+}
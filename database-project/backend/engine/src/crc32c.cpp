@@ -0,0 +1,100 @@
+#include "crc32c.hpp"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC32C_X86 1
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// ---------------- SOFTWARE (slice-by-8) ----------------
+static const uint32_t POLY = 0x82F63B78u;   // reflected Castagnoli polynomial
+
+static std::array<std::array<uint32_t, 256>, 8> makeTables() {
+    std::array<std::array<uint32_t, 256>, 8> t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c >> 1) ^ ((c & 1) ? POLY : 0);
+        t[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (int s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+    }
+    return t;
+}
+
+static const auto TABLES = makeTables();
+
+uint32_t CRC32C::extendSoftware(uint32_t crc, const void* data, size_t len) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    uint32_t c = ~crc;
+
+    while (len >= 8) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, p, 4);
+        std::memcpy(&hi, p + 4, 4);
+        lo ^= c;   // little-endian load
+        c = TABLES[7][lo & 0xFF] ^ TABLES[6][(lo >> 8) & 0xFF] ^
+            TABLES[5][(lo >> 16) & 0xFF] ^ TABLES[4][lo >> 24] ^
+            TABLES[3][hi & 0xFF] ^ TABLES[2][(hi >> 8) & 0xFF] ^
+            TABLES[1][(hi >> 16) & 0xFF] ^ TABLES[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) c = (c >> 8) ^ TABLES[0][(c ^ *p++) & 0xFF];
+
+    return ~c;
+}
+
+// ---------------- SSE4.2 ----------------
+#ifdef CRC32C_X86
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("sse4.2")))
+#endif
+static uint32_t extendHardware(uint32_t crc, const void* data, size_t len) {
+    const auto* p = static_cast<const uint8_t*>(data);
+    uint64_t c = ~crc;
+
+    while (len >= 8) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        c = _mm_crc32_u64(c, v);
+        p += 8;
+        len -= 8;
+    }
+    uint32_t c32 = static_cast<uint32_t>(c);
+    while (len--) c32 = _mm_crc32_u8(c32, *p++);
+
+    return ~c32;
+}
+
+static bool detectSSE42() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+static const bool HAS_SSE42 = detectSSE42();
+#endif
+
+bool CRC32C::hardware() {
+#ifdef CRC32C_X86
+    return HAS_SSE42;
+#else
+    return false;
+#endif
+}
+
+uint32_t CRC32C::extend(uint32_t crc, const void* data, size_t len) {
+#ifdef CRC32C_X86
+    if (HAS_SSE42) return extendHardware(crc, data, len);
+#endif
+    return extendSoftware(crc, data, len);
+}
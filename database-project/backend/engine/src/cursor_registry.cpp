@@ -0,0 +1,95 @@
+#include "cursor_registry.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+
+using Clock = std::chrono::steady_clock;
+
+static size_t envSize(const char* name, size_t fallback) {
+    const char* v = std::getenv(name);
+    if (v) {
+        try { return static_cast<size_t>(std::stoull(v)); } catch (...) { }
+    }
+    return fallback;
+}
+
+static const auto CURSOR_TIMEOUT = std::chrono::milliseconds(envSize("ENGINE_CURSOR_TIMEOUT_MS", 600000));
+static const size_t MAX_CURSORS = envSize("ENGINE_MAX_CURSORS", 1024);
+
+namespace {
+struct Entry {
+    std::mutex m;                       // one batch at a time per cursor
+    std::unique_ptr<FindCursor> cursor;
+    Clock::time_point lastUsed;
+};
+}
+
+static std::mutex registryMutex;
+static std::unordered_map<uint64_t, std::shared_ptr<Entry>> cursors;
+static uint64_t nextCursorId = 1;
+static Clock::time_point lastReap;
+
+// registryMutex held
+static void reapIdleLocked() {
+    auto now = Clock::now();
+    if (now - lastReap < std::chrono::seconds(1)) return;
+    lastReap = now;
+
+    for (auto it = cursors.begin(); it != cursors.end();) {
+        std::unique_lock<std::mutex> busy(it->second->m, std::try_to_lock);
+        if (busy.owns_lock() && now - it->second->lastUsed > CURSOR_TIMEOUT) {
+            std::cout << "[CURSOR] Expired idle cursor " << it->first << std::endl;
+            busy.unlock();
+            it = cursors.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+uint64_t CursorRegistry::open(std::unique_ptr<FindCursor> cursor) {
+    auto e = std::make_shared<Entry>();
+    e->cursor = std::move(cursor);
+    e->lastUsed = Clock::now();
+
+    std::lock_guard<std::mutex> lk(registryMutex);
+    reapIdleLocked();
+    if (MAX_CURSORS && cursors.size() >= MAX_CURSORS) return 0;
+
+    uint64_t id = nextCursorId++;
+    cursors.emplace(id, std::move(e));
+    return id;
+}
+
+bool CursorRegistry::next(uint64_t id, size_t batchSize, std::vector<json>& out, bool& exhausted) {
+    std::shared_ptr<Entry> e;
+    {
+        std::lock_guard<std::mutex> lk(registryMutex);
+        reapIdleLocked();
+        auto it = cursors.find(id);
+        if (it == cursors.end()) return false;
+        e = it->second;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(e->m);
+        e->cursor->nextBatch(batchSize, out);
+        exhausted = e->cursor->exhausted();
+        e->lastUsed = Clock::now();
+    }
+
+    if (exhausted) close(id);
+    return true;
+}
+
+bool CursorRegistry::close(uint64_t id) {
+    std::lock_guard<std::mutex> lk(registryMutex);
+    return cursors.erase(id) > 0;
+}
+
+size_t CursorRegistry::openCount() {
+    std::lock_guard<std::mutex> lk(registryMutex);
+    return cursors.size();
+}
@@ -157,35 +157,95 @@ void DatabaseEngine::insertVector(const std::string& userId,
 }
 
 /* ---------------- FIND ---------------- */
-std::vector<json> DatabaseEngine::find(const std::string& userId,
-                                       const std::string& dbName,
-                                       const std::string& collection,
-                                       const json& filter) {
-    bool isMainUsers = (dbName == "system" && collection == "users");
+static bool isTombstone(const json& d) {
+    return d.contains("_deleted") && d["_deleted"].is_boolean() && d["_deleted"].get<bool>();
+}
+
+// {id: "x"} or {id: {$eq: "x"}}, possibly next to other conditions
+static bool idFromFilter(const json& filter, std::string& id) {
+    if (!filter.is_object()) return false;
+    auto it = filter.find("id");
+    if (it == filter.end()) return false;
+    const json& cond = *it;
+    if (cond.is_string()) { id = cond.get<std::string>(); return true; }
+    if (cond.is_object() && cond.size() == 1 && cond.contains("$eq") && cond["$eq"].is_string()) {
+        id = cond["$eq"].get<std::string>();
+        return true;
+    }
+    return false;
+}
+
+// documents an LSM-backed filter can match: the one LSM::get finds for an
+// id filter (the caller still applies the rest of the filter), else all
+static std::vector<json> candidates(const std::string& userId,
+                                    const std::string& dbName,
+                                    const std::string& collection,
+                                    const json& filter) {
+    std::string id;
+    if (!idFromFilter(filter, id)) return LSM::getAll(userId, dbName, collection);
+
     std::vector<json> docs;
+    json doc;
+    if (LSM::get(userId, dbName, collection, id, doc)) docs.push_back(std::move(doc));
+    return docs;
+}
+
+FindCursor::FindCursor(std::unique_ptr<DocStream> source, const json& filter)
+    : source(std::move(source)) {
+    // parse the filter once instead of per document
+    if (!filter.is_null() && !filter.empty()) query = std::make_unique<QueryNode>(parseQuery(filter));
+}
+
+FindCursor::~FindCursor() = default;
+
+size_t FindCursor::nextBatch(size_t limit, std::vector<json>& out) {
+    size_t added = 0;
+    json d;
+    while (!done && added < limit) {
+        if (!source->next(d)) { done = true; break; }
+
+        // skip tombstones produced by LSM deletes
+        if (isTombstone(d)) continue;
+        if (query && !evalQuery(*query, d)) continue;
+
+        out.push_back(std::move(d));
+        ++added;
+    }
+    return added;
+}
+
+std::unique_ptr<FindCursor> DatabaseEngine::openFind(const std::string& userId,
+                                                     const std::string& dbName,
+                                                     const std::string& collection,
+                                                     const json& filter) {
+    bool isMainUsers = (dbName == "system" && collection == "users");
+    std::unique_ptr<DocStream> source;
 
     if (isMainUsers) {
+        // the system users .bin file is small; it is read in one go
         fs::path file = basePath(userId, dbName) / "data" / (collection + ".bin");
-        docs = Storage::readAll(file.string());
+        source = std::make_unique<VectorDocStream>(Storage::readAll(file.string()));
+    } else if (std::string id; idFromFilter(filter, id)) {
+        // point read instead of a scan
+        source = std::make_unique<VectorDocStream>(candidates(userId, dbName, collection, filter));
     } else {
-        // read via LSM layer (merge memtable + SSTs)
-        docs = LSM::getAll(userId, dbName, collection);
+        // stream via LSM layer (SSTs + memtable snapshot)
+        source = LSM::scan(userId, dbName, collection);
     }
 
-    std::vector<json> matches;
-    for (auto& d : docs) {
-        // skip tombstones produced by LSM deletes
-        if (d.contains("_deleted") && d["_deleted"].is_boolean() && d["_deleted"].get<bool>()) continue;
+    return std::make_unique<FindCursor>(std::move(source), filter);
+}
 
-        if (match(d, filter)) {
-            matches.push_back(d);
-            std::cout << "[ENGINE][FIND MATCH] " << d.dump() << "\n";
-        }
-    }
+std::vector<json> DatabaseEngine::find(const std::string& userId,
+                                       const std::string& dbName,
+                                       const std::string& collection,
+                                       const json& filter) {
+    auto cursor = openFind(userId, dbName, collection, filter);
 
-    std::cout << "[ENGINE][FIND] Matched " << matches.size()
-              << " / " << docs.size() << "\n";
+    std::vector<json> matches;
+    while (!cursor->exhausted()) cursor->nextBatch(1024, matches);
 
+    std::cout << "[ENGINE][FIND] Matched " << matches.size() << "\n";
     return matches;
 }
 
@@ -297,7 +357,7 @@ bool DatabaseEngine::updateOne(
     }
 
     // fallback to LSM path for regular collections
-    auto docs = LSM::getAll(userId, dbName, collection);
+    auto docs = candidates(userId, dbName, collection, filter);
     bool updated = false; json updatedDoc;
 
     for (auto& d : docs) {
@@ -366,7 +426,7 @@ bool DatabaseEngine::deleteOne(const std::string& userId,
     }
 
     // LSM-backed collection: locate matching document, then write a tombstone
-    auto docs = LSM::getAll(userId, dbName, collection);
+    auto docs = candidates(userId, dbName, collection, filter);
     bool found = false; std::string targetId;
 
     for (auto& d : docs) {
@@ -0,0 +1,324 @@
+#include "event_loop.hpp"
+#include "protocol.hpp"
+#include "admission.hpp"
+#include <nlohmann/json.hpp>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static const int MAX_EVENTS = 256;
+static const size_t READ_CHUNK = 64 * 1024;
+
+// per-connection pipelining depth: past this many unanswered requests the
+// reactor stops reading that socket and lets TCP push back on the client.
+// default 256, can be overridden with env ENGINE_CONN_MAX_INFLIGHT
+static const size_t CONN_MAX_INFLIGHT = []() {
+    const char* v = std::getenv("ENGINE_CONN_MAX_INFLIGHT");
+    if (v) {
+        try { return static_cast<size_t>(std::stoull(v)); } catch (...) { }
+    }
+    return static_cast<size_t>(256);
+}();
+
+static void setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags >= 0) fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+EventLoop::EventLoop(WorkerPool& pool, RequestHandler handler)
+    : pool(pool), handler(std::move(handler)) {
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epfd < 0 || wakefd < 0) {
+        std::cerr << "[LOOP] epoll/eventfd setup failed: " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = wakefd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev);
+}
+
+EventLoop::~EventLoop() {
+    for (auto& [fd, c] : conns) ::close(fd);
+    for (int fd : listeners) ::close(fd);
+    if (wakefd >= 0) ::close(wakefd);
+    if (epfd >= 0) ::close(epfd);
+}
+
+void EventLoop::addListener(int fd) {
+    setNonBlocking(fd);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        std::cerr << "[LOOP] cannot watch listener: " << std::strerror(errno) << std::endl;
+        return;
+    }
+    listeners.push_back(fd);
+}
+
+void EventLoop::post(uint64_t connId, std::string bytes, bool closeAfterWrite) {
+    {
+        std::lock_guard<std::mutex> lk(completionMutex);
+        completions.push_back({connId, std::move(bytes), closeAfterWrite});
+    }
+    uint64_t one = 1;
+    ssize_t n = ::write(wakefd, &one, sizeof(one));
+    (void)n;
+}
+
+void EventLoop::run() {
+    std::cout << "[LOOP] epoll reactor running with " << pool.size() << " workers" << std::endl;
+
+    epoll_event events[MAX_EVENTS];
+    while (true) {
+        int n = epoll_wait(epfd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[LOOP] epoll_wait failed: " << std::strerror(errno) << std::endl;
+            return;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            uint32_t evs = events[i].events;
+
+            if (fd == wakefd) {
+                uint64_t cnt;
+                while (::read(wakefd, &cnt, sizeof(cnt)) > 0) {}
+                drainCompletions();
+                continue;
+            }
+
+            bool isListener = false;
+            for (int l : listeners) if (l == fd) { isListener = true; break; }
+            if (isListener) {
+                acceptAll(fd);
+                continue;
+            }
+
+            auto it = conns.find(fd);
+            if (it == conns.end()) continue;
+
+            if (evs & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(fd);
+                continue;
+            }
+            if (evs & EPOLLIN) {
+                onReadable(it->second);
+                // connection may have been closed while reading
+                it = conns.find(fd);
+                if (it == conns.end()) continue;
+            }
+            if (evs & EPOLLOUT) onWritable(it->second);
+        }
+    }
+}
+
+void EventLoop::acceptAll(int listenFd) {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "[LOOP] accept failed: " << std::strerror(errno) << std::endl;
+            }
+            return;
+        }
+
+        // TCP only; a unix socket listener's clients simply refuse the option
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        Connection c;
+        c.fd = fd;
+        c.id = nextConnId++;
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            ::close(fd);
+            continue;
+        }
+        c.events = ev.events;
+
+        connFds[c.id] = fd;
+        conns.emplace(fd, std::move(c));
+    }
+}
+
+void EventLoop::onReadable(Connection& c) {
+    if (readPaused(c)) { updateInterest(c); return; }
+
+    char buf[READ_CHUNK];
+
+    while (true) {
+        ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            c.in.append(buf, static_cast<size_t>(n));
+            continue;
+        }
+        if (n == 0) { c.peerClosed = true; break; }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        closeConnection(c.fd);
+        return;
+    }
+
+    processInput(c);
+}
+
+void EventLoop::processInput(Connection& c) {
+    if (c.mode == Mode::UNKNOWN && c.in.size() > c.inPos) {
+        if (Protocol::isLegacyStart(c.in[c.inPos])) {
+            c.mode = Mode::LEGACY;
+        } else {
+            c.mode = Mode::FRAMED;
+            uint64_t id = c.id;
+            c.session = std::make_shared<Session>(pool, [this, id](std::string frame) {
+                post(id, std::move(frame), false);
+            });
+        }
+    }
+
+    if (c.mode == Mode::LEGACY && c.inFlight == 0) {
+        // one request per connection: wait until the buffered text is a whole
+        // JSON document (or the peer stops sending) before handing it over
+        if (!c.in.empty() && (c.peerClosed || nlohmann::json::accept(c.in))) {
+            std::string payload;
+            payload.swap(c.in);
+            dispatchLegacy(c, std::move(payload));
+        }
+    }
+    else if (c.mode == Mode::FRAMED) {
+        // hand over every complete frame; the session decides what may overlap
+        std::string payload;
+        Protocol::FrameStatus st = Protocol::FrameStatus::NEED_MORE;
+        while (!readPaused(c)
+               && (st = Protocol::nextFrame(c.in, c.inPos, payload)) == Protocol::FrameStatus::READY) {
+            ++c.inFlight;
+            c.session->onFrame(std::move(payload));
+            payload.clear();
+        }
+
+        if (st == Protocol::FrameStatus::TOO_LARGE) {
+            nlohmann::json err = { {"error", "frame too large"}, {"limit", Protocol::maxFrameSize()} };
+            Protocol::appendFrame(c.out, err.dump());
+            c.closeAfterWrite = true;
+            c.in.clear(); c.inPos = 0;
+            onWritable(c);
+            return;
+        }
+
+        // drop the consumed prefix once it dominates the buffer
+        if (c.inPos == c.in.size()) { c.in.clear(); c.inPos = 0; }
+        else if (c.inPos > READ_CHUNK && c.inPos * 2 > c.in.size()) { c.in.erase(0, c.inPos); c.inPos = 0; }
+    }
+
+    if (c.peerClosed && c.inFlight == 0 && c.out.empty()) {
+        closeConnection(c.fd);
+        return;
+    }
+    updateInterest(c);
+}
+
+bool EventLoop::readPaused(const Connection& c) const {
+    return c.mode == Mode::FRAMED && CONN_MAX_INFLIGHT && c.inFlight >= CONN_MAX_INFLIGHT;
+}
+
+void EventLoop::dispatchLegacy(Connection& c, std::string payload) {
+    ++c.inFlight;
+    uint64_t id = c.id;
+    auto buf = std::make_shared<std::string>(std::move(payload));
+
+    if (Admission::tryEnter()) {
+        bool queued = pool.trySubmit([this, id, buf]() {
+            post(id, handler(*buf), true);
+            Admission::leave();
+        });
+        if (queued) return;
+        Admission::leave();
+    }
+    post(id, Admission::busyResponse(nullptr).dump(), true);
+}
+
+void EventLoop::drainCompletions() {
+    std::vector<Completion> ready;
+    {
+        std::lock_guard<std::mutex> lk(completionMutex);
+        ready.swap(completions);
+    }
+
+    for (auto& done : ready) {
+        auto idIt = connFds.find(done.connId);
+        if (idIt == connFds.end()) continue; // client went away meanwhile
+        auto it = conns.find(idIt->second);
+        if (it == conns.end()) continue;
+
+        Connection& c = it->second;
+        bool wasPaused = readPaused(c);
+        if (c.inFlight > 0) --c.inFlight;
+        c.out += done.bytes;
+        c.closeAfterWrite = c.closeAfterWrite || done.closeAfterWrite;
+        int fd = c.fd;
+        onWritable(c);
+
+        // room again: pick up frames that were left buffered while paused
+        auto again = conns.find(fd);
+        if (wasPaused && again != conns.end() && !readPaused(again->second)) processInput(again->second);
+    }
+}
+
+void EventLoop::onWritable(Connection& c) {
+    while (!c.out.empty()) {
+        ssize_t n = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            c.out.erase(0, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        closeConnection(c.fd);
+        return;
+    }
+
+    if (c.out.empty() && (c.closeAfterWrite || (c.peerClosed && c.inFlight == 0))) {
+        closeConnection(c.fd);
+        return;
+    }
+    updateInterest(c);
+}
+
+void EventLoop::updateInterest(Connection& c) {
+    bool reading = !c.peerClosed && !readPaused(c);
+    uint32_t events = (reading ? static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP) : 0u)
+                    | (c.out.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+    if (events == c.events) return;
+
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = c.fd;
+    epoll_ctl(epfd, EPOLL_CTL_MOD, c.fd, &ev);
+    c.events = events;
+}
+
+void EventLoop::closeConnection(int fd) {
+    auto it = conns.find(fd);
+    if (it == conns.end()) return;
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connFds.erase(it->second.id);
+    conns.erase(it);
+}
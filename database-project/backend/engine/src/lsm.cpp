@@ -1,8 +1,10 @@
 #include "lsm.hpp"
 #include "wal.hpp"
+#include "sst.hpp"
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <mutex>
 #include <unordered_map>
 #include <thread>
@@ -10,14 +12,31 @@
 #include <functional>
 #include <unordered_set>
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <cstdlib>
+#include <exception>
+#include <memory>
+#include <algorithm>
 
 namespace fs = std::filesystem;
 
 static std::mutex lsm_mutex;
 
 // memtable keyed by collectionPath -> map<id,json>
-static std::unordered_map<std::string, std::unordered_map<std::string, json>> memtables;
+using Memtable = std::unordered_map<std::string, json>;
+static std::unordered_map<std::string, Memtable> memtables;
+
+// full memtables waiting for the background flusher, oldest first; reads
+// see them between the memtable and the SSTs
+namespace {
+struct ImmutableMemtable {
+    std::shared_ptr<const Memtable> table;
+    uint64_t rotation = 0;      // WAL record that started the segments after it
+};
+}
+static std::unordered_map<std::string, std::deque<ImmutableMemtable>> immutables;
+static std::condition_variable immutableFlushed;   // with lsm_mutex
 static std::string LSM_ROOT;
 // memtable limit: default 1024 entries, can be overridden with env LSM_MEMTABLE_LIMIT
 static size_t MEMTABLE_LIMIT = []() {
@@ -27,12 +46,18 @@ static size_t MEMTABLE_LIMIT = []() {
     }
     return static_cast<size_t>(1024);
 }();
+// writers of a collection stall once this many memtables wait for the
+// flusher (env LSM_MAX_IMMUTABLE_MEMTABLES, default 4)
+static size_t MAX_IMMUTABLES = []() {
+    const char* v = std::getenv("LSM_MAX_IMMUTABLE_MEMTABLES");
+    if (v) {
+        try { return std::max<size_t>(1, std::stoul(v)); } catch (...) { }
+    }
+    return static_cast<size_t>(4);
+}();
 static const size_t COMPACTION_THRESHOLD = 2; // number of SSTs to compact
 static std::atomic<bool> bgRunning(false);
 
-// simple bloom params
-static const size_t BLOOM_SIZE = 1024; // bits
-
 static std::thread bgThread;
 
 void LSM::init(const std::string& rootPath) {
@@ -41,74 +66,718 @@ void LSM::init(const std::string& rootPath) {
     std::cout << "[LSM] Initialized at: " << LSM_ROOT << std::endl;
 }
 
+// <unix seconds>_<sequence>.sst: two flushes within one second must not share a file
+static std::string newSSTName() {
+    static std::atomic<uint64_t> sstSeq(0);
+    return std::to_string(std::time(nullptr)) + "_" + std::to_string(++sstSeq) + ".sst";
+}
+
 static std::string colKey(const std::string& userId, const std::string& db, const std::string& coll) {
     return userId + "/" + db + "/" + coll;
 }
 
-void LSM::put(const std::string& userId, const std::string& dbName, const std::string& collection, const json& doc) {
-    std::lock_guard<std::mutex> lk(lsm_mutex);
+// in-memory SST filters by path
+namespace {
+struct LoadedBloom {
+    std::shared_ptr<const BloomFilter> filter;
+    uint64_t keys = 0;
+};
+}
+static std::mutex bloomMutex;
+static std::unordered_map<std::string, LoadedBloom> blooms;
+static std::atomic<uint64_t> bloomProbes(0);
+static std::atomic<uint64_t> bloomNegatives(0);
+static std::atomic<uint64_t> bloomFalsePositives(0);
+
+static void rememberBloom(const std::string& sstPath, std::shared_ptr<const BloomFilter> filter, uint64_t keys) {
+    if (!filter) return;
+    std::cout << "[LSM][BLOOM] " << sstPath << ": " << keys << " keys, " << filter->bitCount() << " bits, "
+              << filter->hashCount() << " hashes, expected fp " << filter->expectedFpRate(keys) * 100 << "%" << std::endl;
+    std::lock_guard<std::mutex> lk(bloomMutex);
+    blooms[sstPath] = { std::move(filter), keys };
+}
+
+static void forgetBloom(const std::string& sstPath) {
+    std::lock_guard<std::mutex> lk(bloomMutex);
+    blooms.erase(sstPath);
+}
+
+// SST files of a collection, oldest first ("<unix time>_<counter>.sst")
+static std::vector<fs::path> listSSTs(const fs::path& dir) {
+    std::vector<std::pair<std::pair<uint64_t, uint64_t>, fs::path>> found;
+    std::error_code ec;
+    if (!fs::is_directory(dir, ec)) return {};
+    for (auto& e : fs::directory_iterator(dir, ec)) {
+        if (e.path().extension() != ".sst") continue;
+        std::string stem = e.path().stem().string();
+        auto us = stem.find('_');
+        uint64_t t = std::strtoull(stem.c_str(), nullptr, 10);
+        uint64_t n = us == std::string::npos ? 0 : std::strtoull(stem.c_str() + us + 1, nullptr, 10);
+        found.push_back({ {t, n}, e.path() });
+    }
+    std::sort(found.begin(), found.end());
+
+    std::vector<fs::path> out;
+    for (auto& f : found) out.push_back(std::move(f.second));
+    return out;
+}
+
+// ---------------- WRITE COALESCING ----------------
+// Concurrent writers of one collection queue up here. Whoever finds no
+// leader active becomes leader, takes every queued write and applies them
+// as one batch: one WAL append and one memtable lock for the lot. The
+// others sleep until the leader marks their write done.
+namespace {
+struct PendingWrite {
+    bool isDelete = false;
+    std::string id;
+    const json* doc = nullptr;      // PUT only, owned by the waiting caller
+    bool done = false;
+    std::exception_ptr error;
+};
+
+struct WriteQueue {
+    std::mutex m;
+    std::condition_variable cv;
+    std::vector<PendingWrite*> pending;
+    bool leaderActive = false;
+    std::shared_ptr<WalWriter> wal;     // resolved once per collection
+};
+}
+
+static std::mutex queuesMutex;
+static std::unordered_map<std::string, std::shared_ptr<WriteQueue>> writeQueues;
+static std::atomic<uint64_t> batchesApplied(0);
+static std::atomic<uint64_t> writesApplied(0);
+
+static std::shared_ptr<WriteQueue> writeQueueFor(const std::string& userId, const std::string& dbName,
+                                                 const std::string& collection) {
+    std::lock_guard<std::mutex> lk(queuesMutex);
+    auto& q = writeQueues[colKey(userId, dbName, collection)];
+    if (!q) {
+        q = std::make_shared<WriteQueue>();
+        fs::path walFile = fs::path(LSM_ROOT) / userId / dbName / "wal" / (collection + ".wal");
+        q->wal = WAL::writer(walFile.string());
+    }
+    return q;
+}
+
+static bool rotateMemtable(const std::string& key, WalWriter& wal);
+static void scheduleFlush(const std::string& userId, const std::string& dbName, const std::string& collection);
+static std::atomic<uint64_t> writeStalls(0);
+static std::atomic<uint64_t> flushesDone(0);
+
+static void applyBatch(const std::string& userId, const std::string& dbName, const std::string& collection,
+                       WalWriter& wal, const std::vector<PendingWrite*>& batch) {
     std::string key = colKey(userId, dbName, collection);
+    fs::path base = fs::path(LSM_ROOT) / userId / dbName;
+
+    // WAL records point at the queued writes: the document or the key only
+    std::vector<WalWrite> walWrites;
+    walWrites.reserve(batch.size());
+    bool hasDelete = false;
+    for (auto* w : batch) {
+        if (w->isDelete) {
+            hasDelete = true;
+            walWrites.push_back({ WalOp::DELETE, nullptr, &w->id });
+        } else {
+            walWrites.push_back({ WalOp::INSERT, w->doc, nullptr });
+        }
+    }
 
     // ensure directory
-    fs::path dir = fs::path(LSM_ROOT) / userId / dbName / (collection + ".lsm");
-    fs::create_directories(dir);
-    fs::create_directories(fs::path(LSM_ROOT) / userId / dbName / "wal");
-
-    // WAL entry
-    json walEntry = {
-        {"op","PUT"},
-        {"userId", userId},
-        {"db", dbName},
-        {"collection", collection},
-        {"data", doc}
+    fs::create_directories(base / (collection + ".lsm"));
+    fs::create_directories(base / "wal");
+
+    // only this collection's leader writes its WAL, so the commit (and its
+    // sync) happens outside the global lock
+    wal.logWrites(walWrites);
+
+    bool rotated = false;
+    {
+        std::lock_guard<std::mutex> lk(lsm_mutex);
+
+        auto& mt = memtables[key];
+        for (auto* w : batch) {
+            if (w->isDelete) mt[w->id] = json{ {"id", w->id}, {"_deleted", true} };
+            else mt[w->id] = *w->doc;
+        }
+
+        // update column indexes to remove deleted ids
+        if (hasDelete) {
+            try { LSM::updateColumnIndexes(userId, dbName, collection, json::object()); } catch (...) {}
+        }
+
+        // full: becomes immutable, the SST is written in the background
+        if (mt.size() >= MEMTABLE_LIMIT) rotated = rotateMemtable(key, wal);
+    }
+
+    batchesApplied++;
+    writesApplied += batch.size();
+    std::cout << "[LSM][BATCH] " << key << " applied " << batch.size() << " writes" << std::endl;
+
+    if (rotated) {
+        std::cout << "[LSM] memtable threshold reached, flushing in background..." << std::endl;
+        scheduleFlush(userId, dbName, collection);
+
+        // the flusher fell behind: hold this collection's writers (we still
+        // lead its queue) until it catches up
+        std::unique_lock<std::mutex> lk(lsm_mutex);
+        if (immutables[key].size() > MAX_IMMUTABLES) {
+            writeStalls++;
+            std::cout << "[LSM] " << key << " has " << immutables[key].size()
+                      << " memtables waiting for flush, stalling writes" << std::endl;
+            immutableFlushed.wait(lk, [&] { return immutables[key].size() <= MAX_IMMUTABLES; });
+        }
+    }
+}
+
+static void submitWrite(const std::string& userId, const std::string& dbName, const std::string& collection,
+                        PendingWrite& w) {
+    auto q = writeQueueFor(userId, dbName, collection);
+
+    std::unique_lock<std::mutex> lk(q->m);
+    q->pending.push_back(&w);
+
+    while (!w.done) {
+        if (q->leaderActive) {
+            q->cv.wait(lk);
+            continue;
+        }
+
+        // become leader for everything queued so far (our own write included)
+        q->leaderActive = true;
+        std::vector<PendingWrite*> batch;
+        batch.swap(q->pending);
+        lk.unlock();
+
+        std::exception_ptr err;
+        try {
+            applyBatch(userId, dbName, collection, *q->wal, batch);
+        } catch (...) {
+            err = std::current_exception();
+        }
+
+        lk.lock();
+        for (auto* p : batch) { p->error = err; p->done = true; }
+        q->leaderActive = false;
+        q->cv.notify_all();
+    }
+
+    if (w.error) std::rethrow_exception(w.error);
+}
+
+json LSM::writeStats() {
+    uint64_t b = batchesApplied.load(), w = writesApplied.load();
+    size_t waiting = 0;
+    {
+        std::lock_guard<std::mutex> lk(lsm_mutex);
+        for (auto& [key, list] : immutables) waiting += list.size();
+    }
+    return { {"batches", b}, {"writes", w}, {"avgBatchSize", b ? static_cast<double>(w) / b : 0.0},
+             {"immutableMemtables", waiting}, {"flushes", flushesDone.load()}, {"stalls", writeStalls.load()} };
+}
+
+// ---------------- RECOVERY ----------------
+namespace {
+struct RecoveryTarget {
+    std::string userId, dbName, collection;
+    std::string walFile;
+};
+}
+
+// "c.000001.wal" and "c.wal" both belong to collection "c"
+static std::string walCollectionName(const fs::path& walPath) {
+    std::string name = walPath.stem().string();
+    auto dot = name.rfind('.');
+    if (dot != std::string::npos && dot + 1 < name.size() &&
+        name.find_first_not_of("0123456789", dot + 1) == std::string::npos) {
+        name = name.substr(0, dot);
+    }
+    return name;
+}
+
+// collections of a database with a memtable WAL: every "wal/<collection>.wal"
+// whose "<collection>.lsm" exists (db.wal belongs to the .bin storage path
+// and is not a memtable log)
+static std::vector<std::string> collectionsWithWal(const fs::path& dbDir) {
+    std::vector<std::string> out;
+    std::unordered_set<std::string> seen;
+    std::error_code ec;
+    if (!fs::is_directory(dbDir / "wal", ec)) return out;
+
+    for (auto& w : fs::directory_iterator(dbDir / "wal", ec)) {
+        if (w.path().extension() != ".wal") continue;
+        std::string name = walCollectionName(w.path());
+        if (!seen.insert(name).second) continue;
+        if (fs::is_directory(dbDir / (name + ".lsm"), ec)) out.push_back(name);
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+// Bring a record into the current shape: entries written before the
+// compact format become INSERT / DELETE. False for records that carry no
+// document change (checkpoints, unknown entries).
+static bool normalizeRecord(WalRecord& r) {
+    if (r.op == WalOp::CHECKPOINT) return false;
+    if (!r.entry) return true;
+
+    std::string op = r.doc.value("op", "");
+    if (op == "DELETE" && r.doc.contains("id")) {
+        r.op = WalOp::DELETE;
+        r.key = r.doc["id"].is_string() ? r.doc["id"].get<std::string>() : r.doc["id"].dump();
+    } else if (r.doc.contains("data")) {
+        r.op = WalOp::INSERT;
+        json data = std::move(r.doc["data"]);
+        r.doc = std::move(data);
+    } else {
+        return false;
+    }
+    r.entry = false;
+    return true;
+}
+
+// every collection WAL under the data root
+static std::vector<RecoveryTarget> findCollectionWals() {
+    std::vector<RecoveryTarget> out;
+    std::error_code ec;
+    if (!fs::is_directory(LSM_ROOT, ec)) return out;
+
+    for (auto& u : fs::directory_iterator(LSM_ROOT, ec)) {
+        if (!u.is_directory()) continue;
+        for (auto& db : fs::directory_iterator(u.path(), ec)) {
+            if (!db.is_directory()) continue;
+            for (auto& name : collectionsWithWal(db.path())) {
+                out.push_back({ u.path().filename().string(), db.path().filename().string(), name,
+                                (db.path() / "wal" / (name + ".wal")).string() });
+            }
+        }
+    }
+    return out;
+}
+
+static json recoverCollection(const RecoveryTarget& t) {
+    auto started = std::chrono::steady_clock::now();
+
+    // an SST the flusher did not finish; its memtable is replayed below
+    std::error_code ec;
+    fs::path dir = fs::path(LSM_ROOT) / t.userId / t.dbName / (t.collection + ".lsm");
+    for (auto& e : fs::directory_iterator(dir, ec)) {
+        if (e.path().extension() == ".tmp") fs::remove(e.path(), ec);
+    }
+
+    std::unordered_map<std::string, json> replayed;
+    uint64_t records = 0;
+
+    bool clean = WAL::read(t.walFile, [&](WalRecord& r) {
+        if (!normalizeRecord(r)) return;
+
+        records++;
+        if (r.op == WalOp::DELETE) {
+            replayed[r.key] = json{ {"id", r.key}, {"_deleted", true} };
+            return;
+        }
+
+        // same key rule as put(); a document without id gets a key of its own
+        std::string id;
+        if (r.doc.contains("id")) id = r.doc["id"].is_string() ? r.doc["id"].get<std::string>() : r.doc["id"].dump();
+        else id = "wal-" + std::to_string(r.seq ? r.seq : records);
+        replayed[id] = std::move(r.doc);
+    });
+
+    size_t docs = replayed.size();
+    {
+        std::lock_guard<std::mutex> lk(lsm_mutex);
+        auto& mt = memtables[colKey(t.userId, t.dbName, t.collection)];
+        for (auto& [id, doc] : replayed) mt[id] = std::move(doc);
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    double perSec = ms > 0 ? records / (ms / 1000.0) : 0.0;
+    std::cout << "[LSM][RECOVERY] " << colKey(t.userId, t.dbName, t.collection) << ": " << records
+              << " records -> " << docs << " docs in " << ms << " ms (" << static_cast<uint64_t>(perSec)
+              << " records/s)" << (clean ? "" : ", log cut at a bad record") << std::endl;
+
+    return {
+        {"collection", colKey(t.userId, t.dbName, t.collection)},
+        {"records", records},
+        {"docs", docs},
+        {"ms", ms},
+        {"recordsPerSec", perSec},
+        {"clean", clean}
     };
-    std::string walFile = (fs::path(LSM_ROOT) / userId / dbName / "wal" / (collection + ".wal")).string();
-    WAL::log(walFile, walEntry);
+}
 
-    // memtable insert (use id if present)
-    std::string id = doc.contains("id") ? doc["id"].get<std::string>() : std::to_string(std::time(nullptr));
-    memtables[key][id] = doc;
+json LSM::recover() {
+    auto started = std::chrono::steady_clock::now();
+    auto targets = findCollectionWals();
+
+    std::vector<json> results(targets.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&] {
+        for (size_t i; (i = next.fetch_add(1)) < targets.size(); ) {
+            try {
+                results[i] = recoverCollection(targets[i]);
+            } catch (const std::exception& ex) {
+                std::cerr << "[LSM][RECOVERY] " << targets[i].walFile << " failed: " << ex.what() << std::endl;
+                results[i] = { {"collection", colKey(targets[i].userId, targets[i].dbName, targets[i].collection)},
+                               {"error", ex.what()} };
+            }
+        }
+    };
 
-    std::cout << "[LSM][PUT] " << key << " / id=" << id << "\n";
+    // one collection per thread at a time
+    unsigned hw = std::thread::hardware_concurrency();
+    size_t threads = std::min<size_t>(targets.size(), hw ? hw : 4);
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threads; ++i) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
 
-    if (memtables[key].size() >= MEMTABLE_LIMIT) {
-        std::cout << "[LSM] memtable threshold reached, flushing..." << std::endl;
-        LSM::flush(userId, dbName, collection);
+    uint64_t records = 0;
+    for (auto& r : results) records += r.value("records", static_cast<uint64_t>(0));
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    double perSec = ms > 0 ? records / (ms / 1000.0) : 0.0;
+
+    std::cout << "[LSM][RECOVERY] " << targets.size() << " collections, " << records << " records in "
+              << ms << " ms (" << static_cast<uint64_t>(perSec) << " records/s, " << threads << " threads)" << std::endl;
+
+    return {
+        {"collections", std::move(results)},
+        {"records", records},
+        {"ms", ms},
+        {"recordsPerSec", perSec},
+        {"threads", threads}
+    };
+}
+
+// ---------------- CHANGE STREAM ----------------
+static const long WATCH_MAX_AWAIT_MS = []() {
+    const char* v = std::getenv("LSM_WATCH_MAX_AWAIT_MS");
+    long n = v ? std::atol(v) : 10000;
+    return n >= 0 ? n : 10000;
+}();
+
+struct WatchTarget {
+    json origin;                // copied into every event (collection, user, db)
+    std::shared_ptr<WalWriter> wal;
+    uint64_t after;             // last sequence number delivered
+    bool checkHistory;          // `after` came from a resume token
+    bool lost = false;          // the WAL was checkpointed past `after`
+};
+
+// Committed PUT / DELETE records of one collection numbered after t.after,
+// appended to events (up to limit); moves t.after along. False (and
+// t.lost) when the WAL no longer reaches back to t.after + 1.
+static bool readChanges(WatchTarget& t, size_t limit, json& events) {
+    uint64_t upTo = t.wal->durableSeq();
+    bool first = true;
+
+    WAL::read(t.wal->path(), [&](WalRecord& r) {
+        if (r.seq <= t.after || r.seq > upTo || t.lost || events.size() >= limit) return;
+        // a checkpoint heads the oldest segment kept, so a gap shows up here
+        if (first && t.checkHistory && r.seq > t.after + 1) {
+            t.lost = true;
+            return;
+        }
+        first = false;
+        t.after = r.seq;
+        if (!normalizeRecord(r)) return;
+
+        json ev = t.origin;
+        ev["op"] = r.op == WalOp::DELETE ? "delete" : "put";
+        ev["seq"] = r.seq;
+        if (r.op == WalOp::DELETE) {
+            ev["id"] = r.key;
+        } else {
+            ev["id"] = r.doc.contains("id") ? r.doc["id"] : json();
+            ev["doc"] = std::move(r.doc);
+        }
+        events.push_back(std::move(ev));
+    }, t.after);
+    return !t.lost;
+}
+
+// Changes of every target, waiting up to maxAwaitMs for the first one.
+// False as soon as a target lost its history.
+static bool pollChanges(std::vector<WatchTarget>& targets, size_t limit, long maxAwaitMs, json& events) {
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(std::min(std::max(0L, maxAwaitMs), WATCH_MAX_AWAIT_MS));
+    while (true) {
+        uint64_t epoch = WAL::commitEpoch();
+        for (auto& t : targets) {
+            if (events.size() >= limit) break;
+            if (t.wal->durableSeq() <= t.after) continue;
+            if (!readChanges(t, limit, events)) return false;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (!events.empty() || now >= deadline) return true;
+        WAL::waitCommit(epoch, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) +
+                               std::chrono::milliseconds(1));
     }
 }
 
-void LSM::flush(const std::string& userId, const std::string& dbName, const std::string& collection) {
-    std::lock_guard<std::mutex> lk(lsm_mutex);
-    std::string key = colKey(userId, dbName, collection);
-    fs::path dir = fs::path(LSM_ROOT) / userId / dbName / (collection + ".lsm");
+json LSM::watch(const std::string& userId, const std::string& dbName, const std::string& collection,
+                const json& resumeAfter, size_t limit, long maxAwaitMs) {
+    if (limit == 0) limit = 1;
+    fs::path dbDir = fs::path(LSM_ROOT) / userId / dbName;
+
+    // without a token a stream starts at the current end of the log
+    std::vector<WatchTarget> targets;
+    if (!collection.empty()) {
+        auto q = writeQueueFor(userId, dbName, collection);
+        bool resumed = resumeAfter.is_number_unsigned();
+        targets.push_back({ { {"collection", collection} }, q->wal,
+                            resumed ? resumeAfter.get<uint64_t>() : q->wal->durableSeq(), resumed });
+    } else {
+        for (auto& name : collectionsWithWal(dbDir)) {
+            auto q = writeQueueFor(userId, dbName, name);
+            json origin = { {"collection", name} };
+            if (!resumeAfter.is_object()) {
+                targets.push_back({ origin, q->wal, q->wal->durableSeq(), false });
+            } else if (resumeAfter.contains(name) && resumeAfter[name].is_number_unsigned()) {
+                targets.push_back({ origin, q->wal, resumeAfter[name].get<uint64_t>(), true });
+            } else {
+                // created after the token was handed out: all of it is new
+                targets.push_back({ origin, q->wal, 0, false });
+            }
+        }
+    }
+
+    json events = json::array();
+    if (!pollChanges(targets, limit, maxAwaitMs, events)) {
+        for (auto& t : targets) {
+            if (!t.lost) continue;
+            return { {"error", "resume token is older than the retained WAL, reread the collection"},
+                     {"collection", t.origin["collection"]} };
+        }
+    }
+
+    json token;
+    if (!collection.empty()) {
+        token = targets[0].after;
+    } else {
+        token = json::object();
+        for (auto& t : targets) token[t.origin["collection"].get<std::string>()] = t.after;
+    }
+    return { {"status", "ok"}, {"count", events.size()}, {"events", std::move(events)}, {"resumeToken", std::move(token)} };
+}
+
+json LSM::replicate(const json& resumeAfter, size_t limit, long maxAwaitMs) {
+    if (limit == 0) limit = 1;
+
+    // collections the follower has no position for need a full copy first
+    std::vector<WatchTarget> targets;
+    json resync = json::array();
+    for (auto& c : findCollectionWals()) {
+        std::string key = colKey(c.userId, c.dbName, c.collection);
+        json origin = { {"userId", c.userId}, {"dbName", c.dbName}, {"collection", c.collection} };
+        if (!resumeAfter.is_object() || !resumeAfter.contains(key) || !resumeAfter[key].is_number_unsigned()) {
+            resync.push_back(origin);
+            continue;
+        }
+        auto q = writeQueueFor(c.userId, c.dbName, c.collection);
+        targets.push_back({ origin, q->wal, resumeAfter[key].get<uint64_t>(), true });
+    }
+
+    json events = json::array();
+    pollChanges(targets, limit, resync.empty() ? maxAwaitMs : 0, events);
+
+    json token = json::object(), heads = json::object();
+    for (auto& t : targets) {
+        std::string key = colKey(t.origin["userId"], t.origin["dbName"], t.origin["collection"]);
+        if (t.lost) {
+            resync.push_back(t.origin);
+            continue;
+        }
+        token[key] = t.after;
+        heads[key] = t.wal->durableSeq();
+    }
+    return {
+        {"status", "ok"},
+        {"count", events.size()},
+        {"events", std::move(events)},
+        {"resumeToken", std::move(token)},
+        {"heads", std::move(heads)},
+        {"resync", std::move(resync)}
+    };
+}
+
+void LSM::put(const std::string& userId, const std::string& dbName, const std::string& collection, const json& doc) {
+    PendingWrite w;
+    // memtable insert (use id if present)
+    w.id = doc.contains("id") ? doc["id"].get<std::string>() : std::to_string(std::time(nullptr));
+    w.doc = &doc;
+    submitWrite(userId, dbName, collection, w);
+}
+
+// ---------------- FLUSH ----------------
+// Caller holds lsm_mutex and the collection's write leadership: no batch
+// of this collection sits between its WAL commit and its memtable apply,
+// so every WAL record before the rotation is in the table set aside here.
+static bool rotateMemtable(const std::string& key, WalWriter& wal) {
+    auto& mt = memtables[key];
+    if (mt.empty()) return false;
+
+    ImmutableMemtable imm;
+    imm.rotation = wal.rotate();
+    imm.table = std::make_shared<const Memtable>(std::move(mt));
+    mt = Memtable();
+    immutables[key].push_back(std::move(imm));
+    return true;
+}
+
+namespace {
+struct FlushJob {
+    std::string userId, dbName, collection;
+};
+}
+static std::mutex flushJobsMutex;
+static std::condition_variable flushJobsCv;
+static std::deque<FlushJob> flushJobs;
+
+// Writes the oldest immutable memtable of a collection to an SST, then lets
+// the WAL drop the segments it covered. Runs on the flusher thread only, so
+// the tables of one collection go out in order.
+static bool flushOldestImmutable(const FlushJob& job) {
+    std::string key = colKey(job.userId, job.dbName, job.collection);
+    fs::path dir = fs::path(LSM_ROOT) / job.userId / job.dbName / (job.collection + ".lsm");
+
+    ImmutableMemtable imm;
+    {
+        std::lock_guard<std::mutex> lk(lsm_mutex);
+        auto it = immutables.find(key);
+        if (it == immutables.end() || it->second.empty()) return true;
+        imm = it->second.front();
+    }
+
+    // no lock from here to the rename: the table is immutable and readers
+    // keep finding its documents in it
+    std::vector<const std::pair<const std::string, json>*> sorted;
+    sorted.reserve(imm.table->size());
+    for (auto& entry : *imm.table) sorted.push_back(&entry);
+    std::sort(sorted.begin(), sorted.end(), [](auto* a, auto* b) { return a->first < b->first; });
+
+    static std::atomic<uint64_t> tmpSeq(0);
     fs::create_directories(dir);
+    fs::path tmpPath = dir / ("flush_" + std::to_string(++tmpSeq) + ".sst.tmp");
+    SSTWriter out(tmpPath.string());
+    for (auto* entry : sorted) out.add(entry->first, entry->second);
+    // the WAL segments go away below, so the SST must be on disk first
+    if (!out.finish() || !WAL::syncPath(tmpPath.string())) {
+        std::cerr << "[LSM][FLUSH] cannot write sst file for " << key << ", memtable kept" << std::endl;
+        std::error_code ec;
+        fs::remove(tmpPath, ec);
+        return false;
+    }
 
-    if (memtables.find(key) == memtables.end() || memtables[key].empty()) {
-        std::cout << "[LSM][FLUSH] memtable empty for " << key << std::endl;
-        return;
+    // publish: the SST replaces the table in one step for readers. It is
+    // named now, under the lock, so it sorts after any compaction output.
+    std::string sstName;
+    fs::path sstPath;
+    {
+        std::lock_guard<std::mutex> lk(lsm_mutex);
+        sstName = newSSTName();
+        sstPath = dir / sstName;
+        std::error_code ec;
+        fs::rename(tmpPath, sstPath, ec);
+        if (ec) {
+            std::cerr << "[LSM][FLUSH] cannot rename " << tmpPath << ": " << ec.message() << std::endl;
+            fs::remove(tmpPath, ec);
+            return false;
+        }
+        rememberBloom(sstPath.string(), out.filter(), out.entries());
+        immutables[key].pop_front();
+        // update simple column indexes for flushed SST
+        LSM::updateColumnIndexes(job.userId, job.dbName, job.collection, json::object());
     }
+    immutableFlushed.notify_all();
+    WAL::syncPath(dir.string());
+    flushesDone++;
 
-    // create SST file
-    std::string sstName = std::to_string(std::time(nullptr)) + ".sst";
-    fs::path sstPath = dir / sstName;
-    std::ofstream out(sstPath.string(), std::ios::trunc);
-    if (!out.is_open()) {
-        std::cerr << "[LSM][FLUSH] cannot open sst file: " << sstPath << std::endl;
-        return;
+    std::cout << "[LSM][FLUSH] Wrote " << imm.table->size() << " entries to " << sstPath.string() << std::endl;
+
+    // checkpoint: the segments before the rotation are now redundant
+    std::string walFile = (fs::path(LSM_ROOT) / job.userId / job.dbName / "wal" / (job.collection + ".wal")).string();
+    WAL::writer(walFile)->checkpoint({ {"sst", sstName} }, imm.rotation);
+    return true;
+}
+
+static void flusherLoop() {
+    while (true) {
+        FlushJob job;
+        {
+            std::unique_lock<std::mutex> lk(flushJobsMutex);
+            flushJobsCv.wait(lk, [] { return !flushJobs.empty(); });
+            job = std::move(flushJobs.front());
+            flushJobs.pop_front();
+        }
+
+        bool ok = false;
+        try {
+            ok = flushOldestImmutable(job);
+        } catch (const std::exception& ex) {
+            std::cerr << "[LSM][FLUSH] " << colKey(job.userId, job.dbName, job.collection) << " failed: " << ex.what() << std::endl;
+        }
+        if (!ok) {
+            // the table stays readable and in the WAL; try again shortly
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            std::lock_guard<std::mutex> lk(flushJobsMutex);
+            flushJobs.push_front(std::move(job));
+        }
     }
+}
 
-    for (auto& [id, doc] : memtables[key]) {
-        out << doc.dump() << "\n";
+static void scheduleFlush(const std::string& userId, const std::string& dbName, const std::string& collection) {
+    static std::once_flag started;
+    std::call_once(started, [] {
+        std::thread(flusherLoop).detach();
+        std::cout << "[LSM] Background flusher started" << std::endl;
+    });
+
+    {
+        std::lock_guard<std::mutex> lk(flushJobsMutex);
+        flushJobs.push_back({ userId, dbName, collection });
     }
-    out.flush();
-    out.close();
+    flushJobsCv.notify_one();
+}
 
-    std::cout << "[LSM][FLUSH] Wrote " << memtables[key].size() << " entries to " << sstPath.string() << std::endl;
+void LSM::flush(const std::string& userId, const std::string& dbName, const std::string& collection) {
+    auto q = writeQueueFor(userId, dbName, collection);
+    std::string key = colKey(userId, dbName, collection);
 
-    memtables[key].clear();
-    // update simple column indexes for flushed SST
-    updateColumnIndexes(userId, dbName, collection, json::object());
+    // take write leadership so no batch is half applied while rotating
+    {
+        std::unique_lock<std::mutex> lk(q->m);
+        q->cv.wait(lk, [&] { return !q->leaderActive; });
+        q->leaderActive = true;
+    }
 
+    std::exception_ptr err;
+    try {
+        bool rotated;
+        {
+            std::lock_guard<std::mutex> lk(lsm_mutex);
+            rotated = rotateMemtable(key, *q->wal);
+        }
+        if (rotated) scheduleFlush(userId, dbName, collection);
+        else std::cout << "[LSM][FLUSH] memtable empty for " << key << std::endl;
+
+        // wait for this table and any before it
+        std::unique_lock<std::mutex> lk(lsm_mutex);
+        immutableFlushed.wait(lk, [&] { return immutables[key].empty(); });
+    } catch (...) {
+        err = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(q->m);
+        q->leaderActive = false;
+    }
+    q->cv.notify_all();
+    if (err) std::rethrow_exception(err);
 }
 
 // ---------------- COMPACTION ----------------
@@ -117,78 +786,109 @@ void LSM::compact(const std::string& userId, const std::string& dbName, const st
     fs::path dir = fs::path(LSM_ROOT) / userId / dbName / (collection + ".lsm");
     if (!fs::exists(dir)) return;
 
-    // collect sst files
-    std::vector<fs::path> ssts;
-    for (auto& e : fs::directory_iterator(dir)) if (e.path().extension() == ".sst") ssts.push_back(e.path());
+    // collect sst files, oldest first
+    std::vector<fs::path> ssts = listSSTs(dir);
 
     if (ssts.size() < COMPACTION_THRESHOLD) return;
 
-    // simple merge: read all docs and write single merged sst
-    std::unordered_map<std::string, json> merged;
+    // simple merge: read all docs (newer files win) and write single merged sst
+    std::map<std::string, json> merged;
     for (auto& p : ssts) {
-        std::ifstream in(p.string());
-        std::string line;
-        while (std::getline(in, line)) {
-            try {
-                auto j = json::parse(line);
-                std::string id = j.contains("id") ? j["id"].get<std::string>() : std::to_string(std::time(nullptr));
-                merged[id] = j; // last-one-wins
-            } catch (...) { }
+        auto reader = SSTReader::open(p.string());
+        if (!reader) continue;
+        std::string id;
+        json j;
+        while (reader->next(id, j)) {
+            if (id.empty()) id = std::to_string(std::time(nullptr));
+            merged[id] = std::move(j); // last-one-wins
         }
     }
 
     // write merged sst
-    std::string outName = std::to_string(std::time(nullptr)) + ".sst";
+    std::string outName = newSSTName();
     fs::path outPath = dir / outName;
-    std::ofstream out(outPath.string(), std::ios::trunc);
-    for (auto& [id, j] : merged) out << j.dump() << "\n";
-    out.flush(); out.close();
+    SSTWriter out(outPath.string());
+    for (auto& [id, j] : merged) out.add(id, j);
+    if (!out.finish() || !WAL::syncPath(outPath.string())) {
+        std::cerr << "[LSM][COMPACT] cannot write " << outPath.string() << ", inputs kept" << std::endl;
+        std::error_code ec;
+        fs::remove(outPath, ec);
+        return;
+    }
+
+    rememberBloom(outPath.string(), out.filter(), out.entries());
 
-    // remove old ssts
-    for (auto& p : ssts) fs::remove(p);
+    // remove old ssts and their blooms (".bloom" files predate the SST filter)
+    for (auto& p : ssts) {
+        std::error_code ec;
+        fs::remove(p, ec);
+        fs::remove(p.string() + ".bloom", ec);
+        forgetBloom(p.string());
+    }
 
     std::cout << "[LSM][COMPACT] Merged " << ssts.size() << " SSTs into " << outPath.string() << std::endl;
 }
 
-// ---------------- BLOOM FILTER (VERY SIMPLE) ----------------
+// ---------------- BLOOM FILTER ----------------
+// Every SST carries a filter over its keys (see sst.hpp); it is loaded on
+// first probe and kept until compaction removes the file. Legacy text SSTs
+// get one built in memory.
 void LSM::buildBloomForSST(const std::string& sstPath) {
-    try {
-        std::ifstream in(sstPath);
-        if (!in.is_open()) return;
-        std::vector<uint64_t> bits(BLOOM_SIZE/64);
-        std::string line;
-        while (std::getline(in, line)) {
-            try {
-                auto j = json::parse(line);
-                std::string id = j.contains("id") ? j["id"].get<std::string>() : line;
-                uint64_t h = std::hash<std::string>{}(id);
-                size_t idx = h % BLOOM_SIZE;
-                bits[idx/64] |= (1ULL << (idx%64));
-            } catch (...) {}
-        }
+    auto reader = SSTReader::open(sstPath);
+    if (!reader) return;
 
-        // write bloom as json array
-        std::string bloomPath = sstPath + std::string(".bloom");
-        std::ofstream out(bloomPath, std::ios::trunc);
-        json b = json::array();
-        for (auto v : bits) b.push_back(v);
-        out << b.dump();
-        out.close();
-        std::cout << "[LSM][BLOOM] Built bloom for " << sstPath << std::endl;
-    } catch (...) {}
+    std::shared_ptr<const BloomFilter> filter = reader->filter();
+    uint64_t keys = reader->entries();
+    if (!filter) {
+        std::vector<uint64_t> hashes;
+        std::string id;
+        json j;
+        while (reader->next(id, j)) hashes.push_back(BloomFilter::hash(id.empty() ? j.dump() : id));
+        auto built = std::make_shared<BloomFilter>(hashes.size());
+        for (uint64_t h : hashes) built->add(h);
+        filter = std::move(built);
+        keys = hashes.size();
+    }
+    rememberBloom(sstPath, std::move(filter), keys);
 }
 
 bool LSM::mayExistInSST(const std::string& sstPath, const std::string& key) {
-    try {
-        std::string bloomPath = sstPath + std::string(".bloom");
-        std::ifstream in(bloomPath);
-        if (!in.is_open()) return true; // unknown -> check file
-        json b; in >> b;
-        uint64_t h = std::hash<std::string>{}(key);
-        size_t idx = h % BLOOM_SIZE;
-        uint64_t v = b[idx/64].get<uint64_t>();
-        return (v >> (idx%64)) & 1ULL;
-    } catch (...) { return true; }
+    std::shared_ptr<const BloomFilter> filter;
+    {
+        std::lock_guard<std::mutex> lk(bloomMutex);
+        auto it = blooms.find(sstPath);
+        if (it != blooms.end()) filter = it->second.filter;
+    }
+    if (!filter) {
+        LSM::buildBloomForSST(sstPath);
+        std::lock_guard<std::mutex> lk(bloomMutex);
+        auto it = blooms.find(sstPath);
+        if (it == blooms.end()) return true; // unreadable -> let the caller look
+        filter = it->second.filter;
+    }
+
+    bloomProbes++;
+    if (filter->mayContain(key)) return true;
+    bloomNegatives++;
+    return false;
+}
+
+json LSM::bloomStats() {
+    size_t filters = 0, bytes = 0;
+    {
+        std::lock_guard<std::mutex> lk(bloomMutex);
+        filters = blooms.size();
+        for (auto& [path, b] : blooms) bytes += b.filter->memoryBytes();
+    }
+    // measured over lookups of absent keys: filter said maybe, the SST said no
+    uint64_t negatives = bloomNegatives.load(), fp = bloomFalsePositives.load();
+    return { {"filters", filters},
+             {"memoryBytes", bytes},
+             {"bitsPerKey", BloomFilter::defaultBitsPerKey()},
+             {"probes", bloomProbes.load()},
+             {"negatives", negatives},
+             {"falsePositives", fp},
+             {"falsePositiveRate", negatives + fp ? static_cast<double>(fp) / (negatives + fp) : 0.0} };
 }
 
 // ---------------- COLUMNAR INDEX ----------------
@@ -246,36 +946,13 @@ void LSM::updateColumnIndexes(const std::string& userId, const std::string& dbNa
 }
 
 void LSM::del(const std::string& userId, const std::string& dbName, const std::string& collection, const std::string& id) {
-    std::lock_guard<std::mutex> lk(lsm_mutex);
-    std::string key = colKey(userId, dbName, collection);
-
-    // ensure directory
-    fs::path dir = fs::path(LSM_ROOT) / userId / dbName / (collection + ".lsm");
-    fs::create_directories(dir);
-
-    // write DELETE to collection WAL
-    std::string walFile = (fs::path(LSM_ROOT) / userId / dbName / "wal" / (collection + ".wal")).string();
-    json walEntry = {
-        {"op","DELETE"},
-        {"userId", userId},
-        {"db", dbName},
-        {"collection", collection},
-        {"id", id}
-    };
-    WAL::log(walFile, walEntry);
-
-    // insert tombstone into memtable
-    json tomb = { {"id", id}, {"_deleted", true} };
-    memtables[key][id] = tomb;
-    std::cout << "[LSM][DEL] " << key << " / id=" << id << "\n";
-
-    // update column indexes to remove id
-    try { updateColumnIndexes(userId, dbName, collection, json::object()); } catch (...) {}
-
-    if (memtables[key].size() >= MEMTABLE_LIMIT) {
-        std::cout << "[LSM] memtable threshold reached, flushing..." << std::endl;
-        LSM::flush(userId, dbName, collection);
-    }
+    // tombstone + DELETE WAL record go through the same queue as puts, so
+    // they stay ordered with writes to the same collection
+    PendingWrite w;
+    w.isDelete = true;
+    w.id = id;
+    submitWrite(userId, dbName, collection, w);
+    std::cout << "[LSM][DEL] " << colKey(userId, dbName, collection) << " / id=" << id << "\n";
 }
 
 // ---------------- BACKGROUND TASKS ----------------
@@ -316,33 +993,239 @@ void LSM::stopBackgroundTasks() {
     bgRunning.store(false);
     std::cout << "[LSM] Background maintenance stopping" << std::endl;
 }
-std::vector<json> LSM::getAll(const std::string& userId, const std::string& dbName, const std::string& collection) {
+// ---------------- POINT LOOKUP ----------------
+bool LSM::get(const std::string& userId, const std::string& dbName, const std::string& collection,
+              const std::string& id, json& out) {
     std::lock_guard<std::mutex> lk(lsm_mutex);
-    std::vector<json> outDocs;
     std::string key = colKey(userId, dbName, collection);
+
+    auto isTombstone = [](const json& d) {
+        return d.contains("_deleted") && d["_deleted"].is_boolean() && d["_deleted"].get<bool>();
+    };
+
+    // memtable holds the newest version
+    auto mt = memtables.find(key);
+    if (mt != memtables.end()) {
+        auto it = mt->second.find(id);
+        if (it != mt->second.end()) {
+            if (isTombstone(it->second)) return false;
+            out = it->second;
+            return true;
+        }
+    }
+
+    // memtables waiting for flush, newest first
+    auto imm = immutables.find(key);
+    if (imm != immutables.end()) {
+        for (auto t = imm->second.rbegin(); t != imm->second.rend(); ++t) {
+            auto it = t->table->find(id);
+            if (it == t->table->end()) continue;
+            if (isTombstone(it->second)) return false;
+            out = it->second;
+            return true;
+        }
+    }
+
+    // then SSTs, newest first; the first version found decides
     fs::path dir = fs::path(LSM_ROOT) / userId / dbName / (collection + ".lsm");
+    std::vector<fs::path> ssts = listSSTs(dir);
+    size_t skipped = 0;
+    for (auto it = ssts.rbegin(); it != ssts.rend(); ++it) {
+        if (!LSM::mayExistInSST(it->string(), id)) { ++skipped; continue; }
+        auto reader = SSTReader::open(it->string());
+        if (!reader) continue;
+        json doc;
+        if (!reader->get(id, doc)) {
+            bloomFalsePositives++;
+            continue;
+        }
+        if (isTombstone(doc)) return false;
+        out = std::move(doc);
+        return true;
+    }
 
-    if (fs::exists(dir)) {
-        for (auto& entry : fs::directory_iterator(dir)) {
-            if (entry.path().extension() == ".sst") {
-                std::ifstream in(entry.path().string());
-                std::string line;
-                while (std::getline(in, line)) {
-                    try {
-                        outDocs.push_back(json::parse(line));
-                    } catch (...) {
-                        std::cerr << "[LSM] corrupted sst line skipped" << std::endl;
-                    }
-                }
+    if (skipped) std::cout << "[LSM][GET] " << key << " / id=" << id << " not found, bloom skipped "
+                           << skipped << " of " << ssts.size() << " SSTs" << std::endl;
+    return false;
+}
+
+// ---------------- MERGING SCAN ----------------
+// Every source yields (key, document) in ascending key order: each SST
+// and a snapshot of each memtable. Sources are numbered oldest to newest
+// (the SST sequence, the memtables waiting for flush, then the live
+// one), so a min-heap on (key, newest
+// source first) surfaces the winning version of each key; older versions
+// of that key are skipped and tombstones swallowed.
+namespace {
+class MergeSource {
+public:
+    virtual ~MergeSource() = default;
+    virtual bool next(std::string& key, json& doc) = 0;
+};
+
+class SSTSource : public MergeSource {
+public:
+    explicit SSTSource(std::unique_ptr<SSTReader> reader) : reader(std::move(reader)) {}
+    bool next(std::string& key, json& doc) override { return reader->next(key, doc); }
+
+private:
+    std::unique_ptr<SSTReader> reader;
+};
+
+// already sorted in memory: memtable snapshot, legacy text SST
+class SortedSource : public MergeSource {
+public:
+    explicit SortedSource(std::vector<std::pair<std::string, json>> docs) : docs(std::move(docs)) {}
+    bool next(std::string& key, json& doc) override {
+        if (pos >= docs.size()) return false;
+        key = std::move(docs[pos].first);
+        doc = std::move(docs[pos].second);
+        ++pos;
+        return true;
+    }
+
+private:
+    std::vector<std::pair<std::string, json>> docs;
+    size_t pos = 0;
+};
+
+class MergingStream : public DocStream {
+public:
+    // add sources oldest first
+    void add(std::unique_ptr<MergeSource> source) { sources.push_back(std::move(source)); }
+    size_t sourceCount() const { return sources.size(); }
+
+    bool next(json& doc) override {
+        if (!started) {
+            started = true;
+            for (size_t i = 0; i < sources.size(); ++i) advance(i);
+        }
+
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            Head top = std::move(heap.back());
+            heap.pop_back();
+
+            // same key from older sources: superseded
+            while (!heap.empty() && heap.front().key == top.key) {
+                std::pop_heap(heap.begin(), heap.end(), later);
+                size_t older = heap.back().source;
+                heap.pop_back();
+                advance(older);
             }
+            advance(top.source);
+
+            if (isTombstone(top.doc)) continue;
+            doc = std::move(top.doc);
+            return true;
         }
+        return false;
     }
 
-    // overlay memtable (newer entries)
-    if (memtables.find(key) != memtables.end()) {
-        for (auto& [id, doc] : memtables[key]) outDocs.push_back(doc);
+private:
+    struct Head {
+        std::string key;
+        json doc;
+        size_t source;
+    };
+
+    // heap order: smallest key on top, newest source first among equal keys
+    static bool later(const Head& a, const Head& b) {
+        if (a.key != b.key) return a.key > b.key;
+        return a.source < b.source;
+    }
+
+    static bool isTombstone(const json& d) {
+        return d.is_object() && d.contains("_deleted") && d["_deleted"].is_boolean() && d["_deleted"].get<bool>();
     }
 
-    std::cout << "[LSM][GETALL] returning " << outDocs.size() << " docs for " << key << std::endl;
+    void advance(size_t i) {
+        Head h;
+        h.source = i;
+        if (!sources[i]->next(h.key, h.doc)) return;
+        heap.push_back(std::move(h));
+        std::push_heap(heap.begin(), heap.end(), later);
+    }
+
+    std::vector<std::unique_ptr<MergeSource>> sources;
+    std::vector<Head> heap;
+    bool started = false;
+};
+}
+
+// opens every SST now so a concurrent compaction cannot pull files from
+// under the stream, and snapshots the memtables; caller holds lsm_mutex
+static std::unique_ptr<MergingStream> openMerge(const std::string& userId, const std::string& dbName,
+                                                const std::string& collection, size_t& memDocs,
+                                                size_t& sstCount) {
+    auto stream = std::make_unique<MergingStream>();
+    std::string key = colKey(userId, dbName, collection);
+    fs::path dir = fs::path(LSM_ROOT) / userId / dbName / (collection + ".lsm");
+
+    sstCount = 0;
+    for (auto& path : listSSTs(dir)) {
+        auto reader = SSTReader::open(path.string());
+        if (!reader) continue;
+        sstCount++;
+        if (reader->blockBased()) {
+            stream->add(std::make_unique<SSTSource>(std::move(reader)));
+            continue;
+        }
+        // legacy text SST: file order, sort it here (compaction rewrites it)
+        std::map<std::string, json> sorted;
+        std::string id;
+        json doc;
+        while (reader->next(id, doc)) sorted[id] = std::move(doc);
+        stream->add(std::make_unique<SortedSource>(
+            std::vector<std::pair<std::string, json>>(std::make_move_iterator(sorted.begin()),
+                                                      std::make_move_iterator(sorted.end()))));
+    }
+
+    // memtables waiting for flush (oldest first), then the live one
+    auto sortedCopy = [](const Memtable& table) {
+        std::vector<std::pair<std::string, json>> mem(table.begin(), table.end());
+        std::sort(mem.begin(), mem.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        return mem;
+    };
+    memDocs = 0;
+    auto imm = immutables.find(key);
+    if (imm != immutables.end()) {
+        for (auto& t : imm->second) {
+            memDocs += t.table->size();
+            stream->add(std::make_unique<SortedSource>(sortedCopy(*t.table)));
+        }
+    }
+    auto mt = memtables.find(key);
+    if (mt != memtables.end()) {
+        memDocs += mt->second.size();
+        stream->add(std::make_unique<SortedSource>(sortedCopy(mt->second)));
+    }
+    return stream;
+}
+
+std::unique_ptr<DocStream> LSM::scan(const std::string& userId, const std::string& dbName, const std::string& collection) {
+    std::lock_guard<std::mutex> lk(lsm_mutex);
+    size_t memDocs = 0, sstCount = 0;
+    auto stream = openMerge(userId, dbName, collection, memDocs, sstCount);
+
+    std::cout << "[LSM][SCAN] " << colKey(userId, dbName, collection) << " over "
+              << sstCount << " SSTs + " << memDocs << " memtable docs" << std::endl;
+    return stream;
+}
+
+std::vector<json> LSM::getAll(const std::string& userId, const std::string& dbName, const std::string& collection) {
+    std::unique_ptr<MergingStream> stream;
+    {
+        std::lock_guard<std::mutex> lk(lsm_mutex);
+        size_t memDocs = 0, sstCount = 0;
+        stream = openMerge(userId, dbName, collection, memDocs, sstCount);
+    }
+
+    std::vector<json> outDocs;
+    json doc;
+    while (stream->next(doc)) outDocs.push_back(std::move(doc));
+
+    std::cout << "[LSM][GETALL] returning " << outDocs.size() << " docs for "
+              << colKey(userId, dbName, collection) << std::endl;
     return outDocs;
 }
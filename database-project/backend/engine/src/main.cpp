@@ -1,19 +1,29 @@
 #include "server.hpp"
 #include "database_engine.hpp"
 #include <iostream>
+#include <cstdlib>
 #include "lsm.hpp"
+#include "replication.hpp"
 
 
 int main() {
     std::cout << "[MAIN] Starting DB Engine...\n";
-    
-    DatabaseEngine::init(
-        "C:/Users/hites/Desktop/database-project/data"
-    );
+
+    // data root: can be overridden with env ENGINE_DATA_ROOT
+    const char* envRoot = std::getenv("ENGINE_DATA_ROOT");
+    std::string dataRoot = envRoot ? envRoot : "C:/Users/hites/Desktop/database-project/data";
+
+    DatabaseEngine::init(dataRoot);
 
     // initialize LSM layer with same data root
-    LSM::init("C:/Users/hites/Desktop/database-project/data");
+    LSM::init(dataRoot);
+    // rebuild memtables from the collection WALs before taking requests
+    LSM::recover();
     LSM::startBackgroundTasks();
 
+    // ENGINE_FOLLOW=<leader host:port | unix socket path>: read-only follower
+    const char* leader = std::getenv("ENGINE_FOLLOW");
+    if (leader && *leader) Replication::startFollower(leader, dataRoot);
+
     startServer();  // socket server loop
 }
@@ -0,0 +1,276 @@
+// In-process binding of the engine for Node (built with -DBUILD_NODE_ADDON=ON).
+//
+// Every call takes the same request object the socket protocol carries
+// ({ userId, dbName, collection, data | filter | update | ... }) and returns
+// a Promise. JS values are converted straight to nlohmann::json on the main
+// thread, the engine work runs on the libuv thread pool (Napi::AsyncWorker),
+// and the result is converted straight back - no socket, no JSON text.
+#include <napi.h>
+#include "database_engine.hpp"
+#include "lsm.hpp"
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace {
+
+/* ---------------- JS <-> JSON ---------------- */
+
+json toJson(const Napi::Value& v) {
+    if (v.IsNull() || v.IsUndefined()) return nullptr;
+    if (v.IsBoolean()) return v.As<Napi::Boolean>().Value();
+    if (v.IsNumber()) {
+        double d = v.As<Napi::Number>().DoubleValue();
+        // integral values keep the integer type JSON.parse on the engine side would give them
+        if (std::isfinite(d) && std::floor(d) == d && std::fabs(d) < 9007199254740992.0) {
+            if (d >= 0) return static_cast<uint64_t>(d);
+            return static_cast<int64_t>(d);
+        }
+        if (!std::isfinite(d)) return nullptr;   // JSON.stringify does the same
+        return d;
+    }
+    if (v.IsString()) return v.As<Napi::String>().Utf8Value();
+    if (v.IsDate()) {
+        Napi::Object date = v.As<Napi::Object>();
+        return date.Get("toISOString").As<Napi::Function>().Call(date, {}).As<Napi::String>().Utf8Value();
+    }
+    if (v.IsArray()) {
+        Napi::Array arr = v.As<Napi::Array>();
+        json out = json::array();
+        for (uint32_t i = 0; i < arr.Length(); ++i) out.push_back(toJson(arr.Get(i)));
+        return out;
+    }
+    if (v.IsObject() && !v.IsFunction()) {
+        Napi::Object obj = v.As<Napi::Object>();
+        Napi::Array keys = obj.GetPropertyNames();
+        json out = json::object();
+        for (uint32_t i = 0; i < keys.Length(); ++i) {
+            Napi::Value key = keys.Get(i);
+            Napi::Value val = obj.Get(key);
+            if (val.IsUndefined() || val.IsFunction()) continue;
+            out[key.ToString().Utf8Value()] = toJson(val);
+        }
+        return out;
+    }
+    return nullptr;
+}
+
+Napi::Value toJs(Napi::Env env, const json& j) {
+    switch (j.type()) {
+        case json::value_t::null:            return env.Null();
+        case json::value_t::boolean:         return Napi::Boolean::New(env, j.get<bool>());
+        case json::value_t::number_integer:  return Napi::Number::New(env, static_cast<double>(j.get<int64_t>()));
+        case json::value_t::number_unsigned: return Napi::Number::New(env, static_cast<double>(j.get<uint64_t>()));
+        case json::value_t::number_float:    return Napi::Number::New(env, j.get<double>());
+        case json::value_t::string:          return Napi::String::New(env, j.get_ref<const std::string&>());
+        case json::value_t::array: {
+            Napi::Array arr = Napi::Array::New(env, j.size());
+            uint32_t i = 0;
+            for (const auto& item : j) arr.Set(i++, toJs(env, item));
+            return arr;
+        }
+        case json::value_t::object: {
+            Napi::Object obj = Napi::Object::New(env);
+            for (auto it = j.begin(); it != j.end(); ++it) obj.Set(it.key(), toJs(env, it.value()));
+            return obj;
+        }
+        default:
+            return env.Null();
+    }
+}
+
+/* ---------------- ASYNC CALL ---------------- */
+
+using Op = std::function<json(const json& req)>;
+
+// runs one engine call on the libuv pool and settles its promise
+class EngineCall : public Napi::AsyncWorker {
+public:
+    EngineCall(Napi::Env env, Op op, json req)
+        : Napi::AsyncWorker(env, "dbEngineCall"),
+          op(std::move(op)), req(std::move(req)),
+          deferred(Napi::Promise::Deferred::New(env)) {}
+
+    Napi::Promise promise() { return deferred.Promise(); }
+
+    void Execute() override {
+        try {
+            res = op(req);
+        } catch (const std::exception& ex) {
+            SetError(ex.what());
+        } catch (...) {
+            SetError("unknown engine error");
+        }
+    }
+
+    void OnOK() override {
+        deferred.Resolve(toJs(Env(), res));
+    }
+
+    void OnError(const Napi::Error& err) override {
+        deferred.Reject(err.Value());
+    }
+
+private:
+    Op op;
+    json req;
+    json res;
+    Napi::Promise::Deferred deferred;
+};
+
+bool initialized = false;
+std::mutex initMutex;
+
+std::string userOf(const json& req) { return req.value("userId", "system"); }
+
+Napi::Value queue(const Napi::CallbackInfo& info, Op op) {
+    Napi::Env env = info.Env();
+    if (!initialized) {
+        Napi::Error::New(env, "engine not initialized, call init(dataRoot) first").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "request object expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    auto* call = new EngineCall(env, std::move(op), toJson(info[0]));
+    Napi::Promise promise = call->promise();
+    call->Queue();   // the worker deletes itself once settled
+    return promise;
+}
+
+/* ---------------- EXPORTS ---------------- */
+
+// init(dataRoot): same start-up as the server's main(); later calls are no-ops
+Napi::Value Init(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "dataRoot string expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::lock_guard<std::mutex> lk(initMutex);
+    if (!initialized) {
+        std::string dataRoot = info[0].As<Napi::String>().Utf8Value();
+        std::cout << "[ADDON] Starting in-process engine at " << dataRoot << std::endl;
+        DatabaseEngine::init(dataRoot);
+        LSM::init(dataRoot);
+        LSM::recover();
+        LSM::startBackgroundTasks();
+        initialized = true;
+    }
+    return env.Undefined();
+}
+
+Napi::Value Insert(const Napi::CallbackInfo& info) {
+    return queue(info, [](const json& req) {
+        DatabaseEngine::insert(userOf(req), req.at("dbName"), req.at("collection"), req.at("data"));
+        return json{ {"status", "inserted"} };
+    });
+}
+
+Napi::Value InsertVector(const Napi::CallbackInfo& info) {
+    return queue(info, [](const json& req) {
+        DatabaseEngine::insertVector(userOf(req), req.at("dbName"), req.at("collection"), req.at("data"));
+        return json{ {"status", "inserted"} };
+    });
+}
+
+// resolves to the matching documents (what engineClient's normalize() yields)
+Napi::Value Find(const Napi::CallbackInfo& info) {
+    return queue(info, [](const json& req) {
+        json filter = req.contains("filter") ? req["filter"] : json::object();
+        return json(DatabaseEngine::find(userOf(req), req.at("dbName"), req.at("collection"), filter));
+    });
+}
+
+Napi::Value QueryVector(const Napi::CallbackInfo& info) {
+    return queue(info, [](const json& req) {
+        return json(DatabaseEngine::queryVector(userOf(req), req.at("dbName"), req.at("collection"), req));
+    });
+}
+
+Napi::Value UpdateOne(const Napi::CallbackInfo& info) {
+    return queue(info, [](const json& req) {
+        bool ok = DatabaseEngine::updateOne(userOf(req), req.at("dbName"), req.at("collection"),
+                                            req.at("filter"), req.at("update"));
+        return json{ {"status", ok ? "updated" : "not_found"} };
+    });
+}
+
+Napi::Value DeleteOne(const Napi::CallbackInfo& info) {
+    return queue(info, [](const json& req) {
+        bool ok = DatabaseEngine::deleteOne(userOf(req), req.at("dbName"), req.at("collection"), req.at("filter"));
+        return json{ {"status", ok ? "deleted" : "not_found"} };
+    });
+}
+
+// change stream; a long wait (maxAwaitMs) holds one libuv pool thread
+Napi::Value Watch(const Napi::CallbackInfo& info) {
+    return queue(info, [](const json& req) {
+        long long batchSize = req.value("batchSize", 101LL);
+        return LSM::watch(userOf(req), req.at("dbName"), req.value("collection", ""),
+                          req.contains("resumeAfter") ? req["resumeAfter"] : json(),
+                          batchSize > 0 ? static_cast<size_t>(batchSize) : 101,
+                          req.value("maxAwaitMs", 0L));
+    });
+}
+
+// workspace management, so an in-process deployment needs no engine server at all
+Napi::Value InitUserSpace(const Napi::CallbackInfo& info) {
+    return queue(info, [](const json& req) {
+        DatabaseEngine::ensureUserRoot(userOf(req));
+        return json{ {"status", "ok"}, {"message", "user workspace initialized"} };
+    });
+}
+
+Napi::Value CreateDatabase(const Napi::CallbackInfo& info) {
+    return queue(info, [](const json& req) {
+        std::string dbName = req.value("dbName", "");
+        if (dbName.empty()) return json{ {"error", "dbName required"} };
+        DatabaseEngine::createDatabase(userOf(req), dbName);
+        return json{ {"status", "ok"}, {"message", "database created"} };
+    });
+}
+
+Napi::Value CreateCollection(const Napi::CallbackInfo& info) {
+    return queue(info, [](const json& req) {
+        std::string dbName = req.value("dbName", "");
+        std::string coll = req.value("collection", "");
+        if (dbName.empty() || coll.empty()) return json{ {"error", "dbName and collection required"} };
+        DatabaseEngine::createCollection(userOf(req), dbName, coll);
+        return json{ {"status", "ok"}, {"message", "collection created"} };
+    });
+}
+
+Napi::Value ListDatabases(const Napi::CallbackInfo& info) {
+    return queue(info, [](const json& req) {
+        return json(DatabaseEngine::listDatabases(userOf(req)));
+    });
+}
+
+Napi::Object Register(Napi::Env env, Napi::Object exports) {
+    exports.Set("init",             Napi::Function::New(env, Init));
+    exports.Set("insert",           Napi::Function::New(env, Insert));
+    exports.Set("insertVector",     Napi::Function::New(env, InsertVector));
+    exports.Set("find",             Napi::Function::New(env, Find));
+    exports.Set("queryVector",      Napi::Function::New(env, QueryVector));
+    exports.Set("updateOne",        Napi::Function::New(env, UpdateOne));
+    exports.Set("deleteOne",        Napi::Function::New(env, DeleteOne));
+    exports.Set("watch",            Napi::Function::New(env, Watch));
+    exports.Set("initUserSpace",    Napi::Function::New(env, InitUserSpace));
+    exports.Set("createDatabase",   Napi::Function::New(env, CreateDatabase));
+    exports.Set("createCollection", Napi::Function::New(env, CreateCollection));
+    exports.Set("listDatabases",    Napi::Function::New(env, ListDatabases));
+    return exports;
+}
+
+} // namespace
+
+NODE_API_MODULE(db_engine_addon, Register)
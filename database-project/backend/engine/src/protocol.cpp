@@ -0,0 +1,99 @@
+#include "protocol.hpp"
+#include <cstdlib>
+
+size_t Protocol::maxFrameSize() {
+    static const size_t limit = []() {
+        const char* v = std::getenv("ENGINE_MAX_FRAME");
+        if (v) {
+            try { return static_cast<size_t>(std::stoull(v)); } catch (...) { }
+        }
+        return static_cast<size_t>(256) * 1024 * 1024;
+    }();
+    return limit;
+}
+
+bool Protocol::isLegacyStart(char first) {
+    // a framed header would need a >2 GiB length to start with '{'
+    return first == '{';
+}
+
+size_t Protocol::decodeHeader(const unsigned char* h) {
+    return (static_cast<size_t>(h[0]) << 24) | (static_cast<size_t>(h[1]) << 16)
+         | (static_cast<size_t>(h[2]) << 8) | static_cast<size_t>(h[3]);
+}
+
+void Protocol::appendFrame(std::string& out, const std::string& payload) {
+    uint32_t len = static_cast<uint32_t>(payload.size());
+    char header[HEADER_SIZE] = {
+        static_cast<char>((len >> 24) & 0xFF),
+        static_cast<char>((len >> 16) & 0xFF),
+        static_cast<char>((len >> 8) & 0xFF),
+        static_cast<char>(len & 0xFF)
+    };
+    out.append(header, HEADER_SIZE);
+    out.append(payload);
+}
+
+std::string Protocol::encodeFrame(const std::string& payload) {
+    std::string out;
+    out.reserve(HEADER_SIZE + payload.size());
+    appendFrame(out, payload);
+    return out;
+}
+
+Protocol::FrameStatus Protocol::nextFrame(const std::string& buf, size_t& pos, std::string& payload) {
+    if (buf.size() < pos + HEADER_SIZE) return FrameStatus::NEED_MORE;
+
+    size_t len = decodeHeader(reinterpret_cast<const unsigned char*>(buf.data() + pos));
+
+    if (len > maxFrameSize()) return FrameStatus::TOO_LARGE;
+    if (buf.size() < pos + HEADER_SIZE + len) return FrameStatus::NEED_MORE;
+
+    payload.assign(buf, pos + HEADER_SIZE, len);
+    pos += HEADER_SIZE + len;
+    return FrameStatus::READY;
+}
+
+bool Protocol::parseEncoding(const std::string& name, Encoding& out) {
+    if (name == "json")    { out = Encoding::JSON;    return true; }
+    if (name == "msgpack") { out = Encoding::MSGPACK; return true; }
+    if (name == "cbor")    { out = Encoding::CBOR;    return true; }
+    return false;
+}
+
+const char* Protocol::encodingName(Encoding enc) {
+    switch (enc) {
+    case Encoding::MSGPACK: return "msgpack";
+    case Encoding::CBOR:    return "cbor";
+    case Encoding::JSON:    break;
+    }
+    return "json";
+}
+
+nlohmann::json::input_format_t Protocol::inputFormat(Encoding enc) {
+    switch (enc) {
+    case Encoding::MSGPACK: return nlohmann::json::input_format_t::msgpack;
+    case Encoding::CBOR:    return nlohmann::json::input_format_t::cbor;
+    case Encoding::JSON:    break;
+    }
+    return nlohmann::json::input_format_t::json;
+}
+
+std::string Protocol::encode(const nlohmann::json& doc, Encoding enc) {
+    std::string out;
+    switch (enc) {
+    case Encoding::MSGPACK: nlohmann::json::to_msgpack(doc, out); break;
+    case Encoding::CBOR:    nlohmann::json::to_cbor(doc, out); break;
+    case Encoding::JSON:    out = doc.dump(); break;
+    }
+    return out;
+}
+
+nlohmann::json Protocol::decode(const std::string& payload, Encoding enc) {
+    switch (enc) {
+    case Encoding::MSGPACK: return nlohmann::json::from_msgpack(payload, true, false);
+    case Encoding::CBOR:    return nlohmann::json::from_cbor(payload, true, false);
+    case Encoding::JSON:    break;
+    }
+    return nlohmann::json::parse(payload, nullptr, false);
+}
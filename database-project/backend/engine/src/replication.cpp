@@ -0,0 +1,348 @@
+#include "replication.hpp"
+#include "database_engine.hpp"
+#include "lsm.hpp"
+#include "protocol.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+// ---------------- CONFIG ----------------
+static long envLong(const char* name, long fallback) {
+    const char* v = std::getenv(name);
+    if (v) {
+        try { return std::stol(v); } catch (...) { }
+    }
+    return fallback;
+}
+
+// records per replicate round trip, and how long the leader may hold one
+static const long BATCH = std::max(1L, envLong("REPL_BATCH", 1000));
+static const long AWAIT_MS = std::max(0L, envLong("REPL_AWAIT_MS", 1000));
+static const long RETRY_MS = std::max(10L, envLong("REPL_RETRY_MS", 1000));
+
+// ---------------- PLATFORM SOCKETS ----------------
+#ifdef _WIN32
+using Socket = SOCKET;
+static const Socket NO_SOCKET = INVALID_SOCKET;
+static void closeSocket(Socket s) { closesocket(s); }
+#else
+using Socket = int;
+static const Socket NO_SOCKET = -1;
+static void closeSocket(Socket s) { ::close(s); }
+#endif
+
+// "host:port" over TCP, or a unix socket path
+static Socket connectTo(const std::string& leader) {
+#ifndef _WIN32
+    if (!leader.empty() && leader[0] == '/') {
+        sockaddr_un addr{};
+        if (leader.size() >= sizeof(addr.sun_path)) return NO_SOCKET;
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, leader.c_str(), sizeof(addr.sun_path) - 1);
+
+        Socket s = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (s == NO_SOCKET) return NO_SOCKET;
+        if (connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            closeSocket(s);
+            return NO_SOCKET;
+        }
+        return s;
+    }
+#else
+    static bool wsaStarted = [] {
+        WSADATA wsa;
+        return WSAStartup(MAKEWORD(2, 2), &wsa) == 0;
+    }();
+    (void)wsaStarted;
+#endif
+
+    auto colon = leader.rfind(':');
+    std::string host = colon == std::string::npos ? "127.0.0.1" : leader.substr(0, colon);
+    std::string port = colon == std::string::npos ? leader : leader.substr(colon + 1);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0) return NO_SOCKET;
+
+    Socket s = NO_SOCKET;
+    for (addrinfo* a = found; a; a = a->ai_next) {
+        s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (s == NO_SOCKET) continue;
+        if (connect(s, a->ai_addr, static_cast<int>(a->ai_addrlen)) == 0) break;
+        closeSocket(s);
+        s = NO_SOCKET;
+    }
+    freeaddrinfo(found);
+    return s;
+}
+
+static bool sendAll(Socket s, const std::string& bytes) {
+    size_t off = 0;
+    while (off < bytes.size()) {
+        auto n = send(s, bytes.data() + off, static_cast<int>(bytes.size() - off), 0);
+        if (n <= 0) return false;
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool recvAll(Socket s, char* out, size_t len) {
+    size_t off = 0;
+    while (off < len) {
+        auto n = recv(s, out + off, static_cast<int>(len - off), 0);
+        if (n <= 0) return false;
+        off += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// ---------------- FOLLOWER STATE ----------------
+namespace {
+struct State {
+    std::mutex m;
+    std::string leader;
+    bool connected = false;
+    uint64_t applied = 0;               // records applied since start
+    uint64_t copiedDocs = 0;            // documents copied by resyncs
+    uint64_t resyncs = 0;
+    uint64_t errors = 0;
+    uint64_t lagRecords = 0;            // leader's committed end minus applied, summed
+    bool behind = false;
+    Clock::time_point behindSince;      // first seen behind since last caught up
+    Clock::time_point lastContact;
+    double lastApplyMs = 0;
+};
+}
+
+static std::atomic<bool> following(false);
+static State state;
+
+// one framed request / response on the leader connection (JSON encoding,
+// no requestId: the leader answers in order)
+static json call(Socket s, const json& req) {
+    if (!sendAll(s, Protocol::encodeFrame(req.dump()))) throw std::runtime_error("send to leader failed");
+
+    unsigned char header[Protocol::HEADER_SIZE];
+    if (!recvAll(s, reinterpret_cast<char*>(header), sizeof(header))) throw std::runtime_error("leader closed the connection");
+    size_t len = Protocol::decodeHeader(header);
+    if (len > Protocol::maxFrameSize()) throw std::runtime_error("reply from leader too large");
+
+    std::string payload(len, '\0');
+    if (len && !recvAll(s, payload.data(), len)) throw std::runtime_error("leader closed the connection");
+
+    json res = json::parse(payload);
+    if (res.is_object() && res.contains("error")) throw std::runtime_error("leader: " + res["error"].dump());
+    return res;
+}
+
+static std::string posKey(const json& origin) {
+    return origin["userId"].get<std::string>() + "/" + origin["dbName"].get<std::string>() + "/" +
+           origin["collection"].get<std::string>();
+}
+
+static void ensureDatabase(const std::string& userId, const std::string& dbName) {
+    static std::unordered_set<std::string> seen;
+    if (seen.insert(userId + "/" + dbName).second) DatabaseEngine::createDatabase(userId, dbName);
+}
+
+// positions survive restarts; written whole, then renamed over the old file
+static json loadPositions(const fs::path& file) {
+    std::ifstream in(file);
+    if (!in.is_open()) return json::object();
+    try {
+        json j = json::parse(in);
+        if (j.is_object() && j.contains("positions") && j["positions"].is_object()) return j["positions"];
+    } catch (const std::exception& ex) {
+        std::cerr << "[REPL] Ignoring unreadable " << file.string() << ": " << ex.what() << std::endl;
+    }
+    return json::object();
+}
+
+static void savePositions(const fs::path& file, const std::string& leader, const json& positions) {
+    fs::path tmp = file;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << json{ {"leader", leader}, {"positions", positions} }.dump();
+    }
+    std::error_code ec;
+    fs::rename(tmp, file, ec);
+    if (ec) std::cerr << "[REPL] Failed to save positions: " << ec.message() << std::endl;
+}
+
+// Full copy of one collection: take the leader's committed end first, then
+// every document; changes after that end are applied again later (puts and
+// deletes by id are idempotent). Local documents the leader no longer has
+// are deleted.
+static uint64_t resync(Socket s, const json& origin) {
+    std::string userId = origin["userId"], dbName = origin["dbName"], coll = origin["collection"];
+    json head = call(s, { {"action", "watch"}, {"userId", userId}, {"dbName", dbName}, {"collection", coll} });
+    uint64_t token = head.at("resumeToken").get<uint64_t>();
+
+    ensureDatabase(userId, dbName);
+    std::unordered_set<std::string> ids;
+    json page = call(s, { {"action", "find"}, {"userId", userId}, {"dbName", dbName}, {"collection", coll},
+                          {"filter", json::object()}, {"batchSize", BATCH} });
+    uint64_t copied = 0;
+    while (true) {
+        for (auto& doc : page.at("data")) {
+            if (doc.contains("id") && doc["id"].is_string()) ids.insert(doc["id"].get<std::string>());
+            LSM::put(userId, dbName, coll, doc);
+            copied++;
+        }
+        uint64_t cursorId = page.value("cursorId", static_cast<uint64_t>(0));
+        if (!cursorId) break;
+        page = call(s, { {"action", "getMore"}, {"cursorId", cursorId}, {"batchSize", BATCH} });
+    }
+
+    for (auto& doc : LSM::getAll(userId, dbName, coll)) {
+        if (!doc.contains("id") || !doc["id"].is_string() || doc.value("_deleted", false)) continue;
+        std::string id = doc["id"];
+        if (!ids.count(id)) LSM::del(userId, dbName, coll, id);
+    }
+
+    std::cout << "[REPL] Copied " << posKey(origin) << ": " << copied << " docs, resuming after " << token << std::endl;
+    std::lock_guard<std::mutex> lk(state.m);
+    state.resyncs++;
+    state.copiedDocs += copied;
+    return token;
+}
+
+static void followLoop(std::string leader, fs::path positionsFile) {
+    json positions = loadPositions(positionsFile);
+    Socket s = NO_SOCKET;
+
+    while (true) {
+        try {
+            if (s == NO_SOCKET) {
+                s = connectTo(leader);
+                if (s == NO_SOCKET) throw std::runtime_error("cannot connect to leader " + leader);
+#ifndef _WIN32
+                // a leader that stops answering must not hang the follower
+                timeval tv{ (AWAIT_MS + 30000) / 1000, 0 };
+                setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+#endif
+                std::cout << "[REPL] Following " << leader << std::endl;
+                std::lock_guard<std::mutex> lk(state.m);
+                state.connected = true;
+            }
+
+            json res = call(s, { {"action", "replicate"}, {"resumeAfter", positions},
+                                 {"batchSize", BATCH}, {"maxAwaitMs", AWAIT_MS} });
+            auto received = Clock::now();
+            {
+                std::lock_guard<std::mutex> lk(state.m);
+                state.lastContact = received;
+                if (!res["events"].empty() || !res["resync"].empty()) {
+                    if (!state.behind) state.behindSince = received;
+                    state.behind = true;
+                }
+            }
+
+            bool changed = false;
+            for (auto& origin : res["resync"]) {
+                positions[posKey(origin)] = resync(s, origin);
+                changed = true;
+            }
+
+            uint64_t applied = 0;
+            for (auto& ev : res["events"]) {
+                std::string userId = ev["userId"], dbName = ev["dbName"], coll = ev["collection"];
+                ensureDatabase(userId, dbName);
+                if (ev["op"] == "delete") LSM::del(userId, dbName, coll, ev["id"].get<std::string>());
+                else LSM::put(userId, dbName, coll, ev["doc"]);
+                applied++;
+            }
+            for (auto& [key, seq] : res["resumeToken"].items()) {
+                if (positions.value(key, static_cast<uint64_t>(0)) != seq.get<uint64_t>()) changed = true;
+                positions[key] = seq;
+            }
+            // the puts above returned after their own WAL commit, so the
+            // positions never run ahead of what is durable here
+            if (changed) savePositions(positionsFile, leader, positions);
+
+            uint64_t lag = 0;
+            for (auto& [key, head] : res["heads"].items()) {
+                uint64_t at = positions.value(key, static_cast<uint64_t>(0));
+                if (head.get<uint64_t>() > at) lag += head.get<uint64_t>() - at;
+            }
+
+            std::lock_guard<std::mutex> lk(state.m);
+            state.applied += applied;
+            state.lagRecords = lag;
+            if (applied) state.lastApplyMs = std::chrono::duration<double, std::milli>(Clock::now() - received).count();
+            if (lag == 0 && res["resync"].empty()) state.behind = false;
+        } catch (const std::exception& ex) {
+            std::cerr << "[REPL] " << ex.what() << ", retrying in " << RETRY_MS << " ms" << std::endl;
+            if (s != NO_SOCKET) closeSocket(s);
+            s = NO_SOCKET;
+            {
+                std::lock_guard<std::mutex> lk(state.m);
+                state.connected = false;
+                state.errors++;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(RETRY_MS));
+        }
+    }
+}
+
+void Replication::startFollower(const std::string& leader, const std::string& dataRoot) {
+    if (following.exchange(true)) return;
+    {
+        std::lock_guard<std::mutex> lk(state.m);
+        state.leader = leader;
+    }
+    std::cout << "[REPL] Read-only follower of " << leader << std::endl;
+    std::thread(followLoop, leader, fs::path(dataRoot) / "replication.json").detach();
+}
+
+bool Replication::isFollower() {
+    return following.load();
+}
+
+json Replication::stats() {
+    std::lock_guard<std::mutex> lk(state.m);
+    auto now = Clock::now();
+    auto msSince = [&](Clock::time_point t) { return std::chrono::duration<double, std::milli>(now - t).count(); };
+    return {
+        {"role", following.load() ? "follower" : "leader"},
+        {"leader", state.leader},
+        {"connected", state.connected},
+        {"applied", state.applied},
+        {"copiedDocs", state.copiedDocs},
+        {"resyncs", state.resyncs},
+        {"errors", state.errors},
+        {"lagRecords", state.lagRecords},
+        // how long the oldest change not applied yet has been known
+        {"lagMs", state.behind ? msSince(state.behindSince) : 0.0},
+        {"lastApplyMs", state.lastApplyMs},
+        {"lastContactMs", state.lastContact.time_since_epoch().count() ? msSince(state.lastContact) : -1.0}
+    };
+}
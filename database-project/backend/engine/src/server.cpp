@@ -1,110 +1,291 @@
 #include "server.hpp"
 #include "database_engine.hpp"
-#include <ws2tcpip.h>
+#include "lsm.hpp"
+#include "wal.hpp"
+#include "worker_pool.hpp"
+#include "protocol.hpp"
+#include "session.hpp"
+#include "admission.hpp"
+#include "cursor_registry.hpp"
+#include "replication.hpp"
+#include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <iostream>
+#include <cstdlib>
 #include <nlohmann/json.hpp>
 
+#ifdef _WIN32
+#include <ws2tcpip.h>
 #pragma comment(lib, "Ws2_32.lib")
+#else
+#include "event_loop.hpp"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
 
 using json = nlohmann::json;
 
-void handleClient(unsigned long long clientSocket) {
-    SOCKET sock = (SOCKET)clientSocket;
+static int envInt(const char* name, int fallback) {
+    const char* v = std::getenv(name);
+    if (v) {
+        try { return std::stoi(v); } catch (...) { }
+    }
+    return fallback;
+}
 
-    char buffer[8192];
-    int bytes = recv(sock, buffer, sizeof(buffer) - 1, 0);
+// port: default 9000, can be overridden with env ENGINE_PORT
+static const int SERVER_PORT = envInt("ENGINE_PORT", 9000);
 
-    if (bytes <= 0) {
-        closesocket(sock);
-        return;
-    }
+// worker threads: default one per core, can be overridden with env ENGINE_WORKERS
+static size_t workerCount() {
+    int n = envInt("ENGINE_WORKERS", 0);
+    if (n > 0) return static_cast<size_t>(n);
+    unsigned hw = std::thread::hardware_concurrency();
+    return hw ? hw : 4;
+}
 
-    buffer[bytes] = '\0';
-    std::cout << "[SERVER] Received: " << buffer << std::endl;
+// queued requests before new ones are answered "busy": default 1024,
+// can be overridden with env ENGINE_QUEUE_LIMIT (0 = unbounded)
+static size_t queueLimit() {
+    int n = envInt("ENGINE_QUEUE_LIMIT", 1024);
+    return n > 0 ? static_cast<size_t>(n) : 0;
+}
 
-    json req = json::parse(buffer, nullptr, false);
-    json res;
+static WorkerPool* serverPool = nullptr;
+
+// cursor batch size: request "batchSize", default 101
+static size_t batchSizeOf(const json& req) {
+    long long n = req.value("batchSize", 101LL);
+    return n > 0 ? static_cast<size_t>(n) : 101;
+}
+
+/* ---------------- BULK ---------------- */
+static json runBulkOp(const json& op) {
+    std::string a = op.value("action", "");
+    std::string userId = op.value("userId", "system");
 
-    if (req.is_discarded()) {
-        res = { {"error", "Invalid JSON"} };
+    if (a == "insert") {
+        DatabaseEngine::insert(userId, op.at("dbName"), op.at("collection"), op.at("data"));
+        return { {"status", "inserted"} };
     }
-    else {
-        std::string action = req.value("action", "");
-        std::cout << "[SERVER] Action = " << action << std::endl;
+    if (a == "updateOne") {
+        bool ok = DatabaseEngine::updateOne(userId, op.at("dbName"), op.at("collection"), op.at("filter"), op.at("update"));
+        return { {"status", ok ? "updated" : "not_found"} };
+    }
+    if (a == "deleteOne") {
+        bool ok = DatabaseEngine::deleteOne(userId, op.at("dbName"), op.at("collection"), op.at("filter"));
+        return { {"status", ok ? "deleted" : "not_found"} };
+    }
+    return { {"error", "Unknown action"}, {"action", a} };
+}
 
-        // ---------------- PING ----------------
-        if (action == "ping") {
-            res = { {"status", "pong"} };
+// Ops on different collections are independent: they are grouped by
+// (userId, dbName, collection) and the groups run in parallel on the
+// server pool. Inside a group ops run in request order. "results" holds
+// one response per op, at the op's index.
+static json runBulk(const json& ops) {
+    if (!ops.is_array()) return { {"error", "ops must be an array"} };
+
+    std::vector<json> results(ops.size());
+    std::vector<std::vector<size_t>> groups;
+    std::map<std::string, size_t> groupOf;
+
+    for (size_t i = 0; i < ops.size(); ++i) {
+        const json& op = ops[i];
+        std::string key;
+        if (op.is_object()) {
+            for (const char* field : { "userId", "dbName", "collection" }) {
+                auto it = op.find(field);
+                key += (it != op.end() && it->is_string()) ? it->get<std::string>() : std::string();
+                key += '\0';
+            }
         }
+        auto ins = groupOf.emplace(key, groups.size());
+        if (ins.second) groups.emplace_back();
+        groups[ins.first->second].push_back(i);
+    }
 
-        // ---------------- INIT USER SPACE ----------------
-        else if (action == "initUserSpace") {
-            std::string userId = req.value("userId", "system");
-            DatabaseEngine::ensureUserRoot(userId);
-            res = { {"status", "ok"}, {"message", "user workspace initialized"} };
+    auto runGroup = [&](size_t g) {
+        for (size_t i : groups[g]) {
+            try {
+                results[i] = runBulkOp(ops[i]);
+            } catch (const std::exception& ex) {
+                results[i] = { {"error", ex.what()} };
+            }
         }
+    };
 
-        // ---------------- CREATE DATABASE ----------------
-        else if (action == "createDatabase") {
-            std::string userId = req.value("userId", "system");
-            std::string dbName = req.value("dbName", "");
+    if (serverPool && groups.size() > 1) {
+        serverPool->parallelFor(groups.size(), runGroup);
+    } else {
+        for (size_t g = 0; g < groups.size(); ++g) runGroup(g);
+    }
 
-            if (!dbName.empty()) {
-                DatabaseEngine::createDatabase(userId, dbName);
-                res = { {"status", "ok"}, {"message", "database created"} };
-            } else {
-                res = { {"error", "dbName required"} };
-            }
-        }
+    int inserted = 0, updated = 0, deleted_count = 0, errors = 0;
+    for (const auto& r : results) {
+        std::string st = r.value("status", "");
+        if (st == "inserted") inserted++;
+        else if (st == "updated") updated++;
+        else if (st == "deleted") deleted_count++;
+        else errors++;
+    }
 
-        // ---------------- CREATE COLLECTION ----------------
-        else if (action == "createCollection") {
-            std::string userId = req.value("userId", "system");
-            std::string dbName = req.value("dbName", "");
-            std::string coll  = req.value("collection", "");
+    std::cout << "[SERVER][BULK] " << ops.size() << " ops in " << groups.size() << " groups" << std::endl;
 
-            if (!dbName.empty() && !coll.empty()) {
-                DatabaseEngine::createCollection(userId, dbName, coll);
-                res = { {"status", "ok"}, {"message", "collection created"} };
-            } else {
-                res = { {"error", "dbName and collection required"} };
-            }
+    return {
+        {"status", "ok"},
+        {"inserted", inserted}, {"updated", updated}, {"deleted", deleted_count}, {"errors", errors},
+        {"results", std::move(results)}
+    };
+}
+
+/* ---------------- REQUEST DISPATCH ---------------- */
+// actions a read-only follower refuses
+static bool isWriteAction(const std::string& action) {
+    return action == "insert" || action == "insertVector" || action == "updateOne" || action == "deleteOne" ||
+           action == "bulk" || action == "createDatabase" || action == "createCollection" ||
+           action == "initUserSpace";
+}
+
+static json dispatchAction(const json& req) {
+    json res;
+
+    std::string action = req.value("action", "");
+    std::cout << "[SERVER] Action = " << action << std::endl;
+
+    if (isWriteAction(action) && Replication::isFollower()) {
+        return { {"error", "read-only follower, send writes to the leader"} };
+    }
+
+    // ---------------- PING ----------------
+    if (action == "ping") {
+        res = { {"status", "pong"} };
+    }
+
+    // ---------------- STATS ----------------
+    else if (action == "stats") {
+        res = { {"status", "ok"} };
+        res["inFlight"] = Admission::inFlight();
+        res["maxInFlight"] = Admission::limit();
+        res["shed"] = Admission::rejected();
+        res["openCursors"] = CursorRegistry::openCount();
+        res["writes"] = LSM::writeStats();
+        res["bloom"] = LSM::bloomStats();
+        res["wal"] = WAL::stats();
+        res["replication"] = Replication::stats();
+        if (serverPool) {
+            auto st = serverPool->stats();
+            res["pool"] = {
+                {"threads", st.threads},
+                {"active", st.active},
+                {"queueDepth", st.queued},
+                {"peakQueueDepth", st.peakQueued},
+                {"queueLimit", st.maxQueue},
+                {"completed", st.completed},
+                {"rejected", st.rejected},
+                {"avgWaitMs", st.avgWaitMs},
+                {"maxWaitMs", st.maxWaitMs}
+            };
         }
+    }
 
-        // ---------------- LIST DATABASES ----------------
-        else if (action == "listDatabases") {
-            std::string userId = req.value("userId", "system");
-            auto dbs = DatabaseEngine::listDatabases(userId);
-            res = dbs; // respond as array
+    // ---------------- INIT USER SPACE ----------------
+    else if (action == "initUserSpace") {
+        std::string userId = req.value("userId", "system");
+        DatabaseEngine::ensureUserRoot(userId);
+        res = { {"status", "ok"}, {"message", "user workspace initialized"} };
+    }
+
+    // ---------------- CREATE DATABASE ----------------
+    else if (action == "createDatabase") {
+        std::string userId = req.value("userId", "system");
+        std::string dbName = req.value("dbName", "");
+
+        if (!dbName.empty()) {
+            DatabaseEngine::createDatabase(userId, dbName);
+            res = { {"status", "ok"}, {"message", "database created"} };
+        } else {
+            res = { {"error", "dbName required"} };
         }
+    }
 
-        // ---------------- INSERT ----------------
-        else if (action == "insert") {
-            DatabaseEngine::insert(
-                req.value("userId", "system"),
-                req["dbName"],
-                req["collection"],
-                req["data"]
-            );
-            res = { {"status", "inserted"} };
+    // ---------------- CREATE COLLECTION ----------------
+    else if (action == "createCollection") {
+        std::string userId = req.value("userId", "system");
+        std::string dbName = req.value("dbName", "");
+        std::string coll  = req.value("collection", "");
+
+        if (!dbName.empty() && !coll.empty()) {
+            DatabaseEngine::createCollection(userId, dbName, coll);
+            res = { {"status", "ok"}, {"message", "collection created"} };
+        } else {
+            res = { {"error", "dbName and collection required"} };
         }
+    }
 
-        // ---------------- INSERT VECTOR ----------------
-        else if (action == "insertVector") {
-            DatabaseEngine::insertVector(
+    // ---------------- LIST DATABASES ----------------
+    else if (action == "listDatabases") {
+        std::string userId = req.value("userId", "system");
+        auto dbs = DatabaseEngine::listDatabases(userId);
+        res = dbs; // respond as array
+    }
+
+    // ---------------- INSERT ----------------
+    else if (action == "insert") {
+        DatabaseEngine::insert(
+            req.value("userId", "system"),
+            req["dbName"],
+            req["collection"],
+            req["data"]
+        );
+        res = { {"status", "inserted"} };
+    }
+
+    // ---------------- INSERT VECTOR ----------------
+    else if (action == "insertVector") {
+        DatabaseEngine::insertVector(
+            req.value("userId", "system"),
+            req["dbName"],
+            req["collection"],
+            req["data"]
+        );
+        res = { {"status", "inserted"} };
+    }
+
+    // ---------------- FIND ----------------
+    else if (action == "find") {
+        std::cout << "[SERVER] Dispatching FIND\n";
+
+        if (req.contains("batchSize")) {
+            // cursor mode: first batch now, the rest through getMore
+            auto cursor = DatabaseEngine::openFind(
                 req.value("userId", "system"),
                 req["dbName"],
                 req["collection"],
-                req["data"]
+                req["filter"]
             );
-            res = { {"status", "inserted"} };
-        }
 
-        // ---------------- FIND ----------------
-        else if (action == "find") {
-            std::cout << "[SERVER] Dispatching FIND\n";
+            std::vector<json> batch;
+            cursor->nextBatch(batchSizeOf(req), batch);
 
+            uint64_t cursorId = 0;
+            if (!cursor->exhausted()) {
+                cursorId = CursorRegistry::open(std::move(cursor));
+                if (!cursorId) return { {"error", "too many open cursors"} };
+            }
+
+            res["status"]   = "ok";
+            res["count"]    = batch.size();
+            res["data"]     = std::move(batch);
+            res["cursorId"] = cursorId;
+            res["hasMore"]  = cursorId != 0;
+        } else {
             auto results = DatabaseEngine::find(
                 req.value("userId", "system"),
                 req["dbName"],
@@ -114,92 +295,221 @@ void handleClient(unsigned long long clientSocket) {
 
             res["status"] = "ok";
             res["count"]  = results.size();
-            res["data"]   = results;
+            res["data"]   = std::move(results);
         }
+    }
 
-        // ---------------- VECTOR QUERY ----------------
-        else if (action == "queryVector") {
-            std::cout << "[SERVER] Dispatching VECTOR QUERY\n";
-            auto results = DatabaseEngine::queryVector(
-                req.value("userId", "system"),
-                req["dbName"],
-                req["collection"],
-                req
-            );
-            res["status"] = "ok";
-            res["count"] = results.size();
-            res["data"] = results;
+    // ---------------- GET MORE ----------------
+    else if (action == "getMore") {
+        uint64_t cursorId = req.value("cursorId", static_cast<uint64_t>(0));
+        std::vector<json> batch;
+        bool exhausted = false;
+
+        if (!CursorRegistry::next(cursorId, batchSizeOf(req), batch, exhausted)) {
+            res = { {"error", "cursor not found"}, {"cursorId", cursorId} };
+        } else {
+            res["status"]   = "ok";
+            res["count"]    = batch.size();
+            res["data"]     = std::move(batch);
+            res["cursorId"] = exhausted ? 0 : cursorId;
+            res["hasMore"]  = !exhausted;
         }
+    }
 
-        // ---------------- UPDATE ONE ----------------
-        else if (action == "updateOne") {
-            std::cout << "[SERVER] Dispatching UPDATE_ONE\n";
+    // ---------------- KILL CURSORS ----------------
+    else if (action == "killCursors") {
+        json ids = req.contains("cursorIds") ? req["cursorIds"] : json::array({ req.value("cursorId", static_cast<uint64_t>(0)) });
+        int killed = 0;
+        for (auto& id : ids) {
+            if (id.is_number_unsigned() && CursorRegistry::close(id.get<uint64_t>())) killed++;
+        }
+        res = { {"status", "ok"}, {"killed", killed} };
+    }
 
-            bool ok = DatabaseEngine::updateOne(
+    // ---------------- WATCH ----------------
+    // change stream: resend with the returned resumeToken to keep following;
+    // a request waiting for commits (maxAwaitMs) holds its worker meanwhile
+    else if (action == "watch") {
+        std::string dbName = req.value("dbName", "");
+        if (dbName.empty()) {
+            res = { {"error", "dbName required"} };
+        } else {
+            res = LSM::watch(
                 req.value("userId", "system"),
-                req["dbName"],
-                req["collection"],
-                req["filter"],
-                req["update"]
+                dbName,
+                req.value("collection", ""),
+                req.contains("resumeAfter") ? req["resumeAfter"] : json(),
+                batchSizeOf(req),
+                req.value("maxAwaitMs", 0L)
             );
-
-            res["status"] = ok ? "updated" : "not_found";
         }
+    }
 
-        // ---------------- DELETE ONE ----------------
-        else if (action == "deleteOne") {
-            std::cout << "[SERVER] Dispatching DELETE_ONE\n";
+    // ---------------- REPLICATE ----------------
+    // WAL shipping to a follower (see replication.hpp)
+    else if (action == "replicate") {
+        res = LSM::replicate(
+            req.contains("resumeAfter") ? req["resumeAfter"] : json::object(),
+            batchSizeOf(req),
+            req.value("maxAwaitMs", 0L)
+        );
+    }
 
-            bool ok = DatabaseEngine::deleteOne(
-                req.value("userId", "system"),
-                req["dbName"],
-                req["collection"],
-                req["filter"]
-            );
+    // ---------------- VECTOR QUERY ----------------
+    else if (action == "queryVector") {
+        std::cout << "[SERVER] Dispatching VECTOR QUERY\n";
+        auto results = DatabaseEngine::queryVector(
+            req.value("userId", "system"),
+            req["dbName"],
+            req["collection"],
+            req
+        );
+        res["status"] = "ok";
+        res["count"] = results.size();
+        res["data"] = results;
+    }
 
-            res["status"] = ok ? "deleted" : "not_found";
-        }
+    // ---------------- UPDATE ONE ----------------
+    else if (action == "updateOne") {
+        std::cout << "[SERVER] Dispatching UPDATE_ONE\n";
 
-        // ---------------- BULK ----------------
-        else if (action == "bulk") {
-            // expect: { action: 'bulk', ops: [ { action: 'insert', ... }, { action: 'deleteOne', ... } ] }
-            auto ops = req.value("ops", json::array());
-            int inserted = 0, updated = 0, deleted_count = 0, errors = 0;
-
-            for (auto &op : ops) {
-                try {
-                    std::string a = op.value("action", "");
-                    if (a == "insert") {
-                        DatabaseEngine::insert(op.value("userId", "system"), op["dbName"], op["collection"], op["data"]);
-                        inserted++;
-                    } else if (a == "updateOne") {
-                        bool ok2 = DatabaseEngine::updateOne(op.value("userId", "system"), op["dbName"], op["collection"], op["filter"], op["update"]);
-                        if (ok2) updated++; else errors++;
-                    } else if (a == "deleteOne") {
-                        bool ok3 = DatabaseEngine::deleteOne(op.value("userId", "system"), op["dbName"], op["collection"], op["filter"]);
-                        if (ok3) deleted_count++; else errors++;
-                    } else {
-                        errors++;
-                    }
-                } catch (...) {
-                    errors++;
-                }
-            }
+        bool ok = DatabaseEngine::updateOne(
+            req.value("userId", "system"),
+            req["dbName"],
+            req["collection"],
+            req["filter"],
+            req["update"]
+        );
+
+        res["status"] = ok ? "updated" : "not_found";
+    }
+
+    // ---------------- DELETE ONE ----------------
+    else if (action == "deleteOne") {
+        std::cout << "[SERVER] Dispatching DELETE_ONE\n";
+
+        bool ok = DatabaseEngine::deleteOne(
+            req.value("userId", "system"),
+            req["dbName"],
+            req["collection"],
+            req["filter"]
+        );
+
+        res["status"] = ok ? "deleted" : "not_found";
+    }
+
+    // ---------------- BULK ----------------
+    else if (action == "bulk") {
+        // expect: { action: 'bulk', ops: [ { action: 'insert', ... }, { action: 'deleteOne', ... } ] }
+        res = runBulk(req.value("ops", json::array()));
+    }
+
+    // ---------------- UNKNOWN ----------------
+    else {
+        res = {
+            {"error", "Unknown action"},
+            {"action", action}
+        };
+    }
+
+    return res;
+}
+
+json handleRequest(const json& req) {
+    if (req.is_discarded()) return { {"error", "Invalid JSON"} };
+    try {
+        return dispatchAction(req);
+    } catch (const std::exception& ex) {
+        return { {"error", ex.what()} };
+    }
+}
+
+// legacy connections: raw request text in, raw response text out (runs on a worker thread)
+static std::string handlePayload(const std::string& payload) {
+    std::cout << "[SERVER] Received: " << payload << std::endl;
+    return handleRequest(json::parse(payload, nullptr, false)).dump();
+}
+
+#ifdef _WIN32
+/* ---------------- WINSOCK FRONT END ---------------- */
+static bool recvAll(SOCKET sock, char* buf, size_t len) {
+    while (len > 0) {
+        int n = recv(sock, buf, (int)len, 0);
+        if (n <= 0) return false;
+        buf += n; len -= n;
+    }
+    return true;
+}
+
+static bool sendAll(SOCKET sock, const std::string& data) {
+    size_t off = 0;
+    while (off < data.size()) {
+        int n = send(sock, data.data() + off, (int)(data.size() - off), 0);
+        if (n <= 0) return false;
+        off += n;
+    }
+    return true;
+}
+
+void handleClient(unsigned long long clientSocket) {
+    SOCKET sock = (SOCKET)clientSocket;
 
-            res = { {"status", "ok"}, {"inserted", inserted}, {"updated", updated}, {"deleted", deleted_count}, {"errors", errors} };
+    char first;
+    if (recv(sock, &first, 1, MSG_PEEK) <= 0) {
+        closesocket(sock);
+        return;
+    }
+
+    if (Protocol::isLegacyStart(first)) {
+        // legacy: read until the buffered text is a whole JSON document
+        std::string payload;
+        char buffer[8192];
+        while (true) {
+            int bytes = recv(sock, buffer, sizeof(buffer), 0);
+            if (bytes <= 0) break;
+            payload.append(buffer, bytes);
+            if (json::accept(payload)) break;
         }
+        if (!payload.empty()) {
+            if (Admission::tryEnter()) {
+                sendAll(sock, handlePayload(payload));
+                Admission::leave();
+            } else {
+                sendAll(sock, Admission::busyResponse(nullptr).dump());
+            }
+        }
+        closesocket(sock);
+        return;
+    }
 
-        // ---------------- UNKNOWN ----------------
-        else {
-            res = {
-                {"error", "Unknown action"},
-                {"action", action}
-            };
+    // framed: this thread only cuts frames, the session runs them on the pool;
+    // responses are written under the guard so none lands on a recycled handle
+    struct SocketGuard { std::mutex m; bool closed = false; };
+    auto guard = std::make_shared<SocketGuard>();
+    auto session = std::make_shared<Session>(*serverPool, [sock, guard](std::string frame) {
+        std::lock_guard<std::mutex> lk(guard->m);
+        if (!guard->closed) sendAll(sock, frame);
+    });
+
+    while (true) {
+        unsigned char header[Protocol::HEADER_SIZE];
+        if (!recvAll(sock, reinterpret_cast<char*>(header), sizeof(header))) break;
+
+        size_t len = Protocol::decodeHeader(header);
+        if (len > Protocol::maxFrameSize()) {
+            json err = { {"error", "frame too large"}, {"limit", Protocol::maxFrameSize()} };
+            std::lock_guard<std::mutex> lk(guard->m);
+            sendAll(sock, Protocol::encodeFrame(err.dump()));
+            break;
         }
+
+        std::string payload(len, '\0');
+        if (len > 0 && !recvAll(sock, payload.data(), len)) break;
+        session->onFrame(std::move(payload));
     }
 
-    std::string out = res.dump();
-    send(sock, out.c_str(), (int)out.size(), 0);
+    std::lock_guard<std::mutex> lk(guard->m);
+    guard->closed = true;
     closesocket(sock);
 }
 
@@ -211,16 +521,94 @@ void startServer() {
 
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
-    addr.sin_port = htons(9000);
+    addr.sin_port = htons(SERVER_PORT);
     addr.sin_addr.s_addr = INADDR_ANY;
 
     bind(server, (sockaddr*)&addr, sizeof(addr));
     listen(server, SOMAXCONN);
 
-    std::cout << "[SERVER] Listening on port 9000...\n";
+    std::cout << "[SERVER] Listening on port " << SERVER_PORT << "...\n";
+
+    WorkerPool pool(workerCount(), queueLimit());
+    serverPool = &pool;
 
     while (true) {
         SOCKET client = accept(server, nullptr, nullptr);
         std::thread(handleClient, (unsigned long long)client).detach();
     }
 }
+#else
+/* ---------------- EPOLL FRONT END ---------------- */
+static int listenTcp() {
+    int server = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server < 0) {
+        std::cerr << "[SERVER] socket failed: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SERVER_PORT);
+    addr.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(server, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(server, SOMAXCONN) < 0) {
+        std::cerr << "[SERVER] bind/listen on port " << SERVER_PORT << " failed: "
+                  << std::strerror(errno) << std::endl;
+        ::close(server);
+        return -1;
+    }
+
+    std::cout << "[SERVER] Listening on port " << SERVER_PORT << "...\n";
+    return server;
+}
+
+// Unix domain socket for clients on the same host (same protocol, no loopback
+// TCP stack). path: default /tmp/db_engine.sock, can be overridden with env
+// ENGINE_UNIX_SOCKET; set it to an empty string to disable.
+static int listenUnix() {
+    const char* env = std::getenv("ENGINE_UNIX_SOCKET");
+    std::string path = env ? env : "/tmp/db_engine.sock";
+    if (path.empty()) return -1;
+
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "[SERVER] unix socket path too long: " << path << std::endl;
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server < 0) {
+        std::cerr << "[SERVER] unix socket failed: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+
+    ::unlink(path.c_str()); // stale socket file from a previous run
+    if (bind(server, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(server, SOMAXCONN) < 0) {
+        std::cerr << "[SERVER] bind/listen on " << path << " failed: "
+                  << std::strerror(errno) << std::endl;
+        ::close(server);
+        return -1;
+    }
+
+    std::cout << "[SERVER] Listening on unix socket " << path << "...\n";
+    return server;
+}
+
+void startServer() {
+    int tcp = listenTcp();
+    int local = listenUnix();
+    if (tcp < 0 && local < 0) return;
+
+    WorkerPool pool(workerCount(), queueLimit());
+    serverPool = &pool;
+    EventLoop loop(pool, handlePayload);
+    if (tcp >= 0) loop.addListener(tcp);
+    if (local >= 0) loop.addListener(local);
+    loop.run();
+}
+#endif
@@ -0,0 +1,188 @@
+#include "session.hpp"
+#include "server.hpp"
+#include "protocol.hpp"
+#include "admission.hpp"
+#include <iostream>
+
+using json = nlohmann::json;
+
+// Pulls one top-level field out of a request without building the
+// document: "requestId" to tag the busy reply of a shed request, "action"
+// to spot the hello frame.
+struct TopLevelFieldScan : nlohmann::json_sax<json> {
+    std::string field;
+    json value;
+    int depth = 0;
+    bool wanted = false;
+
+    explicit TopLevelFieldScan(std::string field) : field(std::move(field)) {}
+
+    bool take(json v) {
+        if (depth == 1 && wanted) { value = std::move(v); return false; } // found: stop parsing
+        return true;
+    }
+
+    bool null() override { return take(nullptr); }
+    bool boolean(bool v) override { return take(v); }
+    bool number_integer(number_integer_t v) override { return take(v); }
+    bool number_unsigned(number_unsigned_t v) override { return take(v); }
+    bool number_float(number_float_t v, const string_t&) override { return take(v); }
+    bool string(string_t& v) override { return take(v); }
+    bool binary(binary_t&) override { return true; }
+    bool start_object(std::size_t) override { ++depth; wanted = false; return true; }
+    bool key(string_t& k) override { wanted = (depth == 1 && k == field); return true; }
+    bool end_object() override { --depth; wanted = false; return true; }
+    bool start_array(std::size_t) override { ++depth; wanted = false; return true; }
+    bool end_array() override { --depth; wanted = false; return true; }
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override { return false; }
+};
+
+static json peekField(const std::string& payload, Protocol::Encoding enc, const char* field) {
+    TopLevelFieldScan scan(field);
+    json::sax_parse(payload, &scan, Protocol::inputFormat(enc), false);
+    return scan.value;
+}
+
+Session::Session(WorkerPool& pool, Writer writer)
+    : pool(pool), writer(std::move(writer)) {}
+
+void Session::onFrame(std::string payload) {
+    if (nextArrival == 0 && encoding == Protocol::Encoding::JSON && handshake(payload)) return;
+
+    uint64_t seq = nextArrival++;
+    auto self = shared_from_this();
+    auto buf = std::make_shared<std::string>(std::move(payload));
+
+    if (Admission::tryEnter()) {
+        if (pool.trySubmit([self, seq, buf]() { self->run(seq, *buf); })) return;
+        Admission::leave();
+    }
+    shed(seq, *buf);
+}
+
+// first frame only: a hello picks the encoding for the rest of the connection
+bool Session::handshake(const std::string& payload) {
+    if (peekField(payload, Protocol::Encoding::JSON, "action") != "hello") return false;
+
+    json req = json::parse(payload, nullptr, false);
+    std::string name = req.value("encoding", std::string("json"));
+    json res;
+    Protocol::Encoding enc;
+    if (Protocol::parseEncoding(name, enc)) {
+        res = { {"status", "ok"}, {"encoding", name} };
+    } else {
+        enc = Protocol::Encoding::JSON;
+        res = { {"error", "unsupported encoding"}, {"encoding", name}, {"supported", {"json", "msgpack", "cbor"}} };
+    }
+    if (req.contains("requestId")) res["requestId"] = req["requestId"];
+
+    // the reply goes out in JSON; everything after it uses the new encoding
+    writer(Protocol::encodeFrame(res.dump()));
+    encoding = enc;
+    std::cout << "[SERVER] Connection encoding = " << Protocol::encodingName(enc) << std::endl;
+    return true;
+}
+
+// overloaded: answer "busy" right away instead of queueing the request
+void Session::shed(uint64_t seq, const std::string& payload) {
+    json id = peekField(payload, encoding, "requestId");
+    if (!id.is_null()) {
+        release(seq);
+        writer(Protocol::encodeFrame(Protocol::encode(Admission::busyResponse(id), encoding)));
+        return;
+    }
+
+    // untagged replies must keep their order, so the busy reply waits its turn
+    {
+        std::lock_guard<std::mutex> lk(laneMutex);
+        parked.emplace(seq, Parked{json(), true});
+    }
+    auto self = shared_from_this();
+    pool.submit([self]() { self->drainOrdered(); });
+}
+
+void Session::run(uint64_t seq, const std::string& payload) {
+    if (encoding == Protocol::Encoding::JSON) {
+        std::cout << "[SERVER] Received: " << payload << std::endl;
+    } else {
+        std::cout << "[SERVER] Received " << payload.size() << " bytes ("
+                  << Protocol::encodingName(encoding) << ")" << std::endl;
+    }
+    json req = Protocol::decode(payload, encoding);
+
+    // tagged: independent of everything else on the connection
+    if (!req.is_discarded() && req.is_object() && req.contains("requestId")) {
+        release(seq);
+        respond(req, handleRequest(req));
+        Admission::leave();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(laneMutex);
+        parked.emplace(seq, Parked{std::move(req), false});
+    }
+    drainOrdered();
+}
+
+void Session::respond(const json& req, json res) {
+    if (!req.is_discarded() && req.is_object() && req.contains("requestId")) {
+        if (!res.is_object()) res = { {"status", "ok"}, {"data", std::move(res)} };
+        res["requestId"] = req["requestId"];
+    }
+    writer(Protocol::encodeFrame(Protocol::encode(res, encoding)));
+}
+
+// laneMutex held
+void Session::releaseLocked(uint64_t seq) {
+    if (seq != nextSeq) {
+        releasedAhead.insert(seq);
+        return;
+    }
+    ++nextSeq;
+    while (!releasedAhead.empty() && *releasedAhead.begin() == nextSeq) {
+        releasedAhead.erase(releasedAhead.begin());
+        ++nextSeq;
+    }
+}
+
+void Session::release(uint64_t seq) {
+    bool orderedReady = false;
+    {
+        std::lock_guard<std::mutex> lk(laneMutex);
+        releaseLocked(seq);
+        orderedReady = parked.count(nextSeq) > 0;
+    }
+
+    // an untagged request was only waiting for this one to be classified
+    if (orderedReady) {
+        auto self = shared_from_this();
+        pool.submit([self]() { self->drainOrdered(); });
+    }
+}
+
+void Session::drainOrdered() {
+    while (true) {
+        uint64_t seq;
+        Parked entry;
+        {
+            std::lock_guard<std::mutex> lk(laneMutex);
+            auto it = parked.find(nextSeq);
+            if (it == parked.end()) return;
+            seq = it->first;
+            entry = std::move(it->second);
+            parked.erase(it);
+        }
+
+        if (entry.shed) {
+            writer(Protocol::encodeFrame(Protocol::encode(Admission::busyResponse(nullptr), encoding)));
+        } else {
+            respond(entry.req, handleRequest(entry.req));
+            Admission::leave();
+        }
+
+        // untagged requests release their slot only once finished
+        std::lock_guard<std::mutex> lk(laneMutex);
+        releaseLocked(seq);
+    }
+}
@@ -0,0 +1,355 @@
+#include "sst.hpp"
+#include "crc32c.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+/* ---------------- FORMAT ---------------- */
+static const uint64_t MAGIC = 0x5453424C4B535354ull;     // "TSSKLBST" little-endian
+static const uint32_t VERSION = 1;
+// [index offset u64][index size u32][meta offset u64][meta size u32]
+// [entries u64][version u32][magic u64]
+static const size_t FOOTER_SIZE = 8 + 4 + 8 + 4 + 8 + 4 + 8;
+static const uint8_t TOMBSTONE = 0x01;
+
+static const size_t BLOCK_BYTES = []() {
+    const char* v = std::getenv("SST_BLOCK_BYTES");
+    long n = v ? std::atol(v) : 4096;
+    return static_cast<size_t>(n >= 256 ? n : 4096);
+}();
+
+template <typename T>
+static void put(std::string& out, T v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+static bool take(const std::string& in, size_t& pos, T& v) {
+    if (pos + sizeof(v) > in.size()) return false;
+    std::memcpy(&v, in.data() + pos, sizeof(v));
+    pos += sizeof(v);
+    return true;
+}
+
+static bool isTombstone(const json& doc) {
+    return doc.is_object() && doc.contains("_deleted") && doc["_deleted"].is_boolean() && doc["_deleted"].get<bool>();
+}
+
+static json tombstone(const std::string& key) {
+    return json{ {"id", key}, {"_deleted", true} };
+}
+
+/* ---------------- WRITER ---------------- */
+SSTWriter::SSTWriter(const std::string& path)
+    : file(path), out(path, std::ios::binary | std::ios::trunc) {
+    if (!out.is_open()) {
+        failed = true;
+        std::cerr << "[SST] cannot open " << path << " for writing" << std::endl;
+    }
+}
+
+void SSTWriter::write(const std::string& bytes) {
+    if (failed) return;
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!out) failed = true;
+    offset += bytes.size();
+}
+
+void SSTWriter::add(const std::string& key, const json& doc) {
+    bool dead = isTombstone(doc);
+    block.push_back(static_cast<char>(dead ? TOMBSTONE : 0));
+    put<uint32_t>(block, static_cast<uint32_t>(key.size()));
+    block.append(key);
+
+    if (dead) {
+        put<uint32_t>(block, 0);
+    } else {
+        std::vector<uint8_t> value = json::to_msgpack(doc);
+        put<uint32_t>(block, static_cast<uint32_t>(value.size()));
+        block.append(reinterpret_cast<const char*>(value.data()), value.size());
+    }
+
+    keyHashes.push_back(BloomFilter::hash(key));
+    blockLastKey = key;
+    count++;
+    if (block.size() >= BLOCK_BYTES) flushBlock();
+}
+
+void SSTWriter::flushBlock() {
+    if (block.empty()) return;
+    put<uint32_t>(block, CRC32C::compute(block.data(), block.size()));
+
+    put<uint32_t>(index, static_cast<uint32_t>(blockLastKey.size()));
+    index.append(blockLastKey);
+    put<uint64_t>(index, offset);
+    put<uint32_t>(index, static_cast<uint32_t>(block.size()));
+    blocks++;
+
+    write(block);
+    block.clear();
+}
+
+bool SSTWriter::finish() {
+    flushBlock();
+
+    // index: [blocks u32][entries...][crc u32]
+    std::string indexBlock;
+    put<uint32_t>(indexBlock, blocks);
+    indexBlock.append(index);
+    put<uint32_t>(indexBlock, CRC32C::compute(indexBlock.data(), indexBlock.size()));
+    uint64_t indexOffset = offset;
+    write(indexBlock);
+
+    if (count) {
+        auto filter = std::make_shared<BloomFilter>(keyHashes.size());
+        for (uint64_t h : keyHashes) filter->add(h);
+        std::string bytes = filter->serialize();
+        if (meta.is_null()) meta = json::object();
+        meta["bloom"] = json::binary(std::vector<uint8_t>(bytes.begin(), bytes.end()));
+        bloom = std::move(filter);
+    }
+
+    uint64_t metaOffset = 0;
+    uint32_t metaSize = 0;
+    if (!meta.is_null()) {
+        std::vector<uint8_t> packed = json::to_msgpack(meta);
+        std::string metaBlock(packed.begin(), packed.end());
+        put<uint32_t>(metaBlock, CRC32C::compute(metaBlock.data(), metaBlock.size()));
+        metaOffset = offset;
+        metaSize = static_cast<uint32_t>(metaBlock.size());
+        write(metaBlock);
+    }
+
+    std::string footer;
+    put<uint64_t>(footer, indexOffset);
+    put<uint32_t>(footer, static_cast<uint32_t>(indexBlock.size()));
+    put<uint64_t>(footer, metaOffset);
+    put<uint32_t>(footer, metaSize);
+    put<uint64_t>(footer, count);
+    put<uint32_t>(footer, VERSION);
+    put<uint64_t>(footer, MAGIC);
+    write(footer);
+
+    if (!failed) {
+        out.flush();
+        if (!out) failed = true;
+    }
+    out.close();
+    if (failed) std::cerr << "[SST] write failed: " << file << std::endl;
+    return !failed;
+}
+
+/* ---------------- READER ---------------- */
+// read size bytes at offset, checking the trailing CRC32C; the CRC is cut off
+static bool readChecked(std::ifstream& in, uint64_t offset, uint32_t size, std::string& out) {
+    if (size < sizeof(uint32_t)) return false;
+    out.resize(size);
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(offset));
+    if (!in.read(out.data(), size)) return false;
+
+    uint32_t crc;
+    std::memcpy(&crc, out.data() + size - sizeof(crc), sizeof(crc));
+    out.resize(size - sizeof(crc));
+    return CRC32C::compute(out.data(), out.size()) == crc;
+}
+
+std::unique_ptr<SSTReader> SSTReader::open(const std::string& path) {
+    std::unique_ptr<SSTReader> r(new SSTReader());
+    r->file = path;
+    r->in.open(path, std::ios::binary);
+    if (!r->in.is_open()) return nullptr;
+
+    r->in.seekg(0, std::ios::end);
+    uint64_t size = static_cast<uint64_t>(r->in.tellg());
+
+    std::string footer(FOOTER_SIZE, '\0');
+    bool hasFooter = size >= FOOTER_SIZE;
+    if (hasFooter) {
+        r->in.seekg(static_cast<std::streamoff>(size - FOOTER_SIZE));
+        hasFooter = static_cast<bool>(r->in.read(footer.data(), FOOTER_SIZE));
+    }
+
+    uint64_t indexOffset = 0, metaOffset = 0, magic = 0;
+    uint32_t indexSize = 0, metaSize = 0, version = 0;
+    size_t p = 0;
+    if (hasFooter) {
+        take(footer, p, indexOffset);
+        take(footer, p, indexSize);
+        take(footer, p, metaOffset);
+        take(footer, p, metaSize);
+        take(footer, p, r->count);
+        take(footer, p, version);
+        take(footer, p, magic);
+    }
+
+    if (!hasFooter || magic != MAGIC) {
+        // newline-delimited JSON from before the block format
+        r->in.clear();
+        r->in.seekg(0);
+        if (size == 0 || r->in.peek() == '{') {
+            r->count = 0;
+            return r;
+        }
+        std::cerr << "[SST] " << path << " has no footer, skipped" << std::endl;
+        return nullptr;
+    }
+    if (version != VERSION) {
+        std::cerr << "[SST] " << path << " has unsupported version " << version << ", skipped" << std::endl;
+        return nullptr;
+    }
+    r->version = version;
+
+    std::string indexBlock;
+    if (!readChecked(r->in, indexOffset, indexSize, indexBlock)) {
+        std::cerr << "[SST] bad index block in " << path << ", skipped" << std::endl;
+        return nullptr;
+    }
+    p = 0;
+    uint32_t blocks = 0;
+    take(indexBlock, p, blocks);
+    r->index.reserve(blocks);
+    for (uint32_t i = 0; i < blocks; ++i) {
+        IndexEntry e;
+        uint32_t keyLen = 0;
+        if (!take(indexBlock, p, keyLen) || p + keyLen > indexBlock.size()) return nullptr;
+        e.lastKey.assign(indexBlock, p, keyLen);
+        p += keyLen;
+        if (!take(indexBlock, p, e.offset) || !take(indexBlock, p, e.size)) return nullptr;
+        r->index.push_back(std::move(e));
+    }
+
+    if (metaSize) {
+        std::string metaBlock;
+        if (readChecked(r->in, metaOffset, metaSize, metaBlock)) {
+            try { r->metaDoc = json::from_msgpack(metaBlock); } catch (...) { }
+            if (r->metaDoc.is_object() && r->metaDoc.contains("bloom") && r->metaDoc["bloom"].is_binary()) {
+                const auto& bytes = r->metaDoc["bloom"].get_binary();
+                r->bloom = BloomFilter::deserialize(std::string(bytes.begin(), bytes.end()));
+                r->metaDoc.erase("bloom");
+            }
+        } else {
+            std::cerr << "[SST] bad meta block in " << path << ", ignored" << std::endl;
+        }
+    }
+    return r;
+}
+
+bool SSTReader::loadBlock(size_t i) {
+    blockNo = i;
+    pos = 0;
+    loaded = false;
+    if (i >= index.size()) return false;
+    if (!readChecked(in, index[i].offset, index[i].size, blockData)) {
+        std::cerr << "[SST] bad block " << i << " in " << file << ", skipped" << std::endl;
+        blockData.clear();
+    }
+    loaded = true;
+    return true;
+}
+
+// decode the entry at pos; doc is only decoded when asked for
+bool SSTReader::nextInBlock(std::string& key, json* doc) {
+    uint8_t flags = 0;
+    uint32_t keyLen = 0, valueLen = 0;
+    size_t p = pos;
+    if (!take(blockData, p, flags) || !take(blockData, p, keyLen) || p + keyLen > blockData.size()) return false;
+    key.assign(blockData, p, keyLen);
+    p += keyLen;
+    if (!take(blockData, p, valueLen) || p + valueLen > blockData.size()) return false;
+
+    if (doc) {
+        if (flags & TOMBSTONE) {
+            *doc = tombstone(key);
+        } else {
+            try {
+                *doc = json::from_msgpack(blockData.data() + p, blockData.data() + p + valueLen);
+            } catch (const std::exception& ex) {
+                std::cerr << "[SST] undecodable entry in " << file << ": " << ex.what() << std::endl;
+                *doc = json();
+            }
+        }
+    }
+    pos = p + valueLen;
+    return true;
+}
+
+bool SSTReader::get(const std::string& key, json& doc) {
+    if (!blockBased()) {
+        std::string k;
+        seek(key);
+        while (next(k, doc)) {
+            if (k == key) return true;
+        }
+        return false;
+    }
+
+    // first block whose last key is not below the key
+    auto it = std::lower_bound(index.begin(), index.end(), key,
+                               [](const IndexEntry& e, const std::string& k) { return e.lastKey < k; });
+    if (it == index.end()) return false;
+    loadBlock(static_cast<size_t>(it - index.begin()));
+
+    std::string k;
+    while (true) {
+        size_t at = pos;
+        if (!nextInBlock(k, nullptr)) return false;
+        if (k < key) continue;
+        if (k != key) return false;
+        pos = at;
+        return nextInBlock(k, &doc);
+    }
+}
+
+void SSTReader::seek(const std::string& key) {
+    if (!blockBased()) {
+        in.clear();
+        in.seekg(0);
+        return;
+    }
+
+    auto it = std::lower_bound(index.begin(), index.end(), key,
+                               [](const IndexEntry& e, const std::string& k) { return e.lastKey < k; });
+    if (it == index.end()) {
+        blockNo = index.size();
+        loaded = false;
+        return;
+    }
+    loadBlock(static_cast<size_t>(it - index.begin()));
+
+    std::string k;
+    while (true) {
+        size_t at = pos;
+        if (!nextInBlock(k, nullptr)) break;
+        if (k >= key) {
+            pos = at;
+            break;
+        }
+    }
+}
+
+bool SSTReader::next(std::string& key, json& doc) {
+    if (!blockBased()) {
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty()) continue;
+            try {
+                doc = json::parse(line);
+            } catch (...) {
+                std::cerr << "[LSM] corrupted sst line skipped" << std::endl;
+                continue;
+            }
+            key = doc.contains("id") && doc["id"].is_string() ? doc["id"].get<std::string>() : "";
+            return true;
+        }
+        return false;
+    }
+
+    while (true) {
+        if (!loaded && !loadBlock(blockNo)) return false;
+        if (nextInBlock(key, &doc)) return true;
+        if (!loadBlock(blockNo + 1)) return false;
+    }
+}
@@ -1,4 +1,5 @@
 #include "storage.hpp"
+#include "crc32c.hpp"
 #include <fstream>
 #include <iostream>
 #include <filesystem>
@@ -6,6 +7,21 @@
 namespace fs = std::filesystem;
 using json = nlohmann::json;
 
+/* ---------------- RECORD FORMAT ---------------- */
+// [len u32 | CHECKSUMMED][crc32c u32 over len + payload][payload]
+// Records written before checksums are a bare [len][payload].
+static const uint32_t CHECKSUMMED = 0x80000000u;
+
+static void appendRecord(std::string& buf, const std::string& data) {
+    uint32_t len = static_cast<uint32_t>(data.size()) | CHECKSUMMED;
+    uint32_t crc = CRC32C::extend(0, &len, sizeof(len));
+    crc = CRC32C::extend(crc, data.data(), data.size());
+
+    buf.append(reinterpret_cast<const char*>(&len), sizeof(len));
+    buf.append(reinterpret_cast<const char*>(&crc), sizeof(crc));
+    buf.append(data);
+}
+
 /* ---------------- APPEND ---------------- */
 void Storage::appendDocument(const std::string& file, const json& doc) {
 
@@ -20,10 +36,10 @@ void Storage::appendDocument(const std::string& file, const json& doc) {
     }
 
     std::string data = doc.dump();
-    uint32_t len = static_cast<uint32_t>(data.size());
+    std::string record;
+    appendRecord(record, data);
 
-    out.write(reinterpret_cast<char*>(&len), sizeof(len));
-    out.write(data.data(), len);
+    out.write(record.data(), static_cast<std::streamsize>(record.size()));
     out.flush();
 
     std::cout << "[STORAGE][APPEND] " << data << "\n";
@@ -47,16 +63,31 @@ std::vector<json> Storage::readAll(const std::string& file) {
         return docs;
     }
 
+    uint64_t offset = 0;
     while (true) {
-        uint32_t len = 0;
-        if (!in.read(reinterpret_cast<char*>(&len), sizeof(len)))
+        uint32_t header = 0;
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
             break;
 
-        if (len == 0) continue;
-
+        uint32_t len = header & ~CHECKSUMMED;
+        uint32_t crc = 0;
         std::string buf(len, '\0');
-        if (!in.read(buf.data(), len))
+
+        // a torn or corrupt record ends the file: nothing after it is trusted
+        bool ok = !(header & CHECKSUMMED) || in.read(reinterpret_cast<char*>(&crc), sizeof(crc));
+        ok = ok && (len == 0 || in.read(buf.data(), len));
+        if (ok && (header & CHECKSUMMED)) {
+            uint32_t actual = CRC32C::extend(0, &header, sizeof(header));
+            ok = CRC32C::extend(actual, buf.data(), buf.size()) == crc;
+        }
+        if (!ok) {
+            std::cerr << "[STORAGE][ERROR] Bad record at offset " << offset
+                      << " in " << file << ", ignoring the rest\n";
             break;
+        }
+        offset += sizeof(header) + ((header & CHECKSUMMED) ? sizeof(crc) : 0) + len;
+
+        if (len == 0) continue;
 
         try {
             docs.push_back(json::parse(buf));
@@ -88,11 +119,11 @@ void Storage::writeAll(const std::string& file,
         return;
     }
 
+    std::string record;
     for (const auto& doc : docs) {
-        std::string data = doc.dump();
-        uint32_t len = static_cast<uint32_t>(data.size());
-        out.write(reinterpret_cast<char*>(&len), sizeof(len));
-        out.write(data.data(), len);
+        record.clear();
+        appendRecord(record, doc.dump());
+        out.write(record.data(), static_cast<std::streamsize>(record.size()));
     }
 
     out.flush();
@@ -1,16 +1,21 @@
 #include "transaction_manager.hpp"
 #include "wal.hpp"
 
+#ifdef _WIN32
 #include <windows.h>
 #include <rpc.h>
+#pragma comment(lib, "Rpcrt4.lib")
+#else
+#include <random>
+#include <cstdio>
+#endif
 
 #include <string>
 #include <mutex>
 #include <unordered_map>
 
-#pragma comment(lib, "Rpcrt4.lib")
-
 // ---------- UUID generator (optional) ----------
+#ifdef _WIN32
 std::string generateUUID() {
     UUID uuid;
     UuidCreate(&uuid);
@@ -23,6 +28,20 @@ std::string generateUUID() {
 
     return uuidStr;
 }
+#else
+std::string generateUUID() {
+    // random (version 4) UUID
+    std::random_device rd;
+    uint32_t w[4] = { rd(), rd(), rd(), rd() };
+    w[1] = (w[1] & 0xFFFF0FFFu) | 0x00004000u;
+    w[2] = (w[2] & 0x3FFFFFFFu) | 0x80000000u;
+
+    char buf[37];
+    std::snprintf(buf, sizeof(buf), "%08x-%04x-%04x-%04x-%04x%08x",
+                  w[0], w[1] >> 16, w[1] & 0xFFFF, w[2] >> 16, w[2] & 0xFFFF, w[3]);
+    return buf;
+}
+#endif
 
 // ---------- Transaction ID generator ----------
 uint64_t TransactionManager::genTxId() {
@@ -45,9 +64,9 @@ Transaction& TransactionManager::begin() {
 // ---------- COMMIT ----------
 void TransactionManager::commit(Transaction& tx,
                                 const std::string& walFile) {
-    for (const auto& entry : tx.walBuffer) {
-        WAL::log(walFile, entry);
-    }
+    // one group commit for the whole transaction
+    std::vector<nlohmann::json> entries(tx.walBuffer.begin(), tx.walBuffer.end());
+    WAL::logBatch(walFile, entries);
 
     tx.state = TxState::COMMITTED;
 
@@ -1,82 +1,912 @@
 #include "wal.hpp"
 #include "database_engine.hpp"
+#include "crc32c.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <condition_variable>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <string>
 #include <nlohmann/json.hpp>
 
-void WAL::log(const std::string& file, const nlohmann::json& entry) {
-    std::ofstream out(file, std::ios::binary | std::ios::app);
-    if (!out.is_open()) {
-        std::cerr << "[WAL] Failed to open WAL file: " << file << "\n";
-        return;
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+// ---------------- PLATFORM FILE I/O ----------------
+// Segments are written at explicit offsets: a preallocated or recycled
+// file is already as long as a full segment, so appending would not work.
+#ifdef _WIN32
+static const int DSYNC_FLAGS = 0;       // no O_DSYNC / O_DIRECT here: buffered only
+static const int DIRECT_FLAGS = 0;
+static int openWrite(const std::string& file, int) {
+    return _open(file.c_str(), _O_WRONLY | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+static bool writeAt(int fd, const char* data, size_t len, uint64_t offset) {
+    if (_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0) return false;
+    while (len > 0) {
+        int n = _write(fd, data, static_cast<unsigned>(len));
+        if (n <= 0) return false;
+        data += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+static bool preallocate(int, uint64_t) { return false; }
+static bool syncFd(int fd) { return _commit(fd) == 0; }
+static void closeFd(int fd) { _close(fd); }
+static char* alignedAlloc(size_t len, size_t align) { return static_cast<char*>(_aligned_malloc(len, align)); }
+static void alignedFree(char* p) { _aligned_free(p); }
+#else
+static const int DSYNC_FLAGS = O_DSYNC;
+#ifdef O_DIRECT
+static const int DIRECT_FLAGS = O_DIRECT | O_DSYNC;
+#else
+static const int DIRECT_FLAGS = 0;
+#endif
+static int openWrite(const std::string& file, int flags) {
+    return ::open(file.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | flags, 0644);
+}
+static bool writeAt(int fd, const char* data, size_t len, uint64_t offset) {
+    while (len > 0) {
+        ssize_t n = ::pwrite(fd, data, len, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+static bool preallocate(int fd, uint64_t len) {
+#ifdef __linux__
+    return ::fallocate(fd, 0, 0, static_cast<off_t>(len)) == 0;
+#else
+    (void)fd; (void)len;
+    return false;
+#endif
+}
+static bool syncFd(int fd) {
+#ifdef __APPLE__
+    return ::fsync(fd) == 0;
+#else
+    return ::fdatasync(fd) == 0;
+#endif
+}
+static void closeFd(int fd) { ::close(fd); }
+static char* alignedAlloc(size_t len, size_t align) {
+    void* p = nullptr;
+    return ::posix_memalign(&p, align, len) == 0 ? static_cast<char*>(p) : nullptr;
+}
+static void alignedFree(char* p) { std::free(p); }
+#endif
+
+// ---------------- CONFIG ----------------
+static long envLong(const char* name, long fallback) {
+    const char* v = std::getenv(name);
+    if (v) {
+        try { return std::stol(v); } catch (...) { }
     }
+    return fallback;
+}
+
+static WalSync SYNC_POLICY = []() {
+    const char* v = std::getenv("WAL_SYNC");
+    std::string p = v ? v : "batch";
+    if (p == "none") return WalSync::NONE;
+    if (p == "interval") return WalSync::INTERVAL;
+    return WalSync::BATCH;
+}();
+static const long SYNC_INTERVAL_MS = std::max(1L, envLong("WAL_SYNC_INTERVAL_MS", 100));
+static const long GROUP_COMMIT_US = std::max(0L, envLong("WAL_GROUP_COMMIT_US", 0));
+
+WalSync WAL::syncPolicy() { return SYNC_POLICY; }
+
+static const long IDLE_CLOSE_MS = std::max(1L, envLong("WAL_IDLE_CLOSE_MS", 30000));
+static const uint64_t SEGMENT_BYTES = static_cast<uint64_t>(std::max(4096L, envLong("WAL_SEGMENT_BYTES", 64L << 20)));
 
-    std::string payload = entry.dump();
-    uint32_t size = static_cast<uint32_t>(payload.size());
-    WalOp op = WalOp::INSERT; // currently only INSERT, extendable later
+// WAL_IO=buffered (default) | dsync | direct
+//   dsync:  O_DSYNC, every write is durable on its own, no fdatasync
+//   direct: O_DIRECT | O_DSYNC with 4 KiB aligned writes, bypassing the page
+//           cache; falls back to dsync where the filesystem refuses it
+enum class WalIo { BUFFERED, DSYNC, DIRECT };
+static const WalIo IO_MODE = []() {
+    const char* v = std::getenv("WAL_IO");
+    std::string m = v ? v : "buffered";
+    if (m == "direct" && DIRECT_FLAGS) return WalIo::DIRECT;
+    if ((m == "dsync" || m == "direct") && DSYNC_FLAGS) return WalIo::DSYNC;
+    return WalIo::BUFFERED;
+}();
+static const size_t IO_ALIGN = 4096;
 
-    out.write(reinterpret_cast<char*>(&op), sizeof(op));
-    out.write(reinterpret_cast<char*>(&size), sizeof(size));
-    out.write(payload.data(), size);
-    out.flush();
+// new segments get their full size allocated up front, and checkpointed
+// segments are kept (up to WAL_RECYCLE_SEGMENTS) to be written over again,
+// so a steady log stops growing files and allocating blocks
+static const bool PREALLOCATE = envLong("WAL_PREALLOCATE", 1) != 0;
+static const long RECYCLE_SEGMENTS = std::max(0L, envLong("WAL_RECYCLE_SEGMENTS", 2));
+
+// ---------------- SEGMENTS ----------------
+// "<dir>/<stem>.wal" is stored as "<dir>/<stem>.<000001>.wal", ...
+static std::vector<std::pair<uint64_t, fs::path>> listSegments(const std::string& file) {
+    std::vector<std::pair<uint64_t, fs::path>> out;
+    fs::path base(file);
+    fs::path dir = base.parent_path();
+    std::string prefix = base.stem().string() + ".";
+
+    std::error_code ec;
+    if (fs::exists(base, ec)) out.emplace_back(0, base);   // written before segments existed
+    if (!fs::is_directory(dir, ec)) return out;
+
+    for (auto& e : fs::directory_iterator(dir, ec)) {
+        std::string name = e.path().filename().string();
+        if (e.path().extension() != ".wal" || name.compare(0, prefix.size(), prefix) != 0) continue;
+        std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - 4);
+        if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos) continue;
+        out.emplace_back(std::stoull(digits), e.path());
+    }
+    std::sort(out.begin(), out.end());
+    return out;
 }
 
-void WAL::replay(const std::string& file) {
-    std::ifstream in(file, std::ios::binary);
-    if (!in.is_open()) return;
+// retired segments waiting to be reused: "<dir>/<stem>.<000001>.free"
+static std::vector<fs::path> listSpares(const std::string& file) {
+    std::vector<fs::path> out;
+    fs::path base(file);
+    std::string prefix = base.stem().string() + ".";
+
+    std::error_code ec;
+    if (!fs::is_directory(base.parent_path(), ec)) return out;
+    for (auto& e : fs::directory_iterator(base.parent_path(), ec)) {
+        std::string name = e.path().filename().string();
+        if (e.path().extension() != ".free" || name.compare(0, prefix.size(), prefix) != 0) continue;
+        std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - 5);
+        if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos) continue;
+        out.push_back(e.path());
+    }
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+static const uint64_t RING_SLOTS = []() {
+    uint64_t n = static_cast<uint64_t>(std::max(16L, envLong("WAL_RING_SLOTS", 4096)));
+    uint64_t p = 1;
+    while (p < n) p <<= 1;          // power of two: ticket & mask picks the slot
+    return p;
+}();
+static const size_t MAX_RUN_BYTES = 4u << 20;   // one write() at most
+
+// ---------------- RING COUNTERS ----------------
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// atomics only: producers never take a lock to account for themselves
+struct Counters {
+    std::atomic<uint64_t> runs{0};          // flusher writes
+    std::atomic<uint64_t> records{0};
+    std::atomic<uint64_t> maxRun{0};
+    std::atomic<uint64_t> commits{0};       // durable appends waited for
+    std::atomic<uint64_t> commitNs{0};
+    std::atomic<uint64_t> maxCommitNs{0};
+    std::atomic<uint64_t> syncs{0};
+    std::atomic<uint64_t> syncNs{0};
+    std::atomic<uint64_t> ringFullWaits{0};
+    std::atomic<uint64_t> opens{0};
+    std::atomic<uint64_t> preallocated{0};
+    std::atomic<uint64_t> recycled{0};
+    std::atomic<uint64_t> idleCloses{0};
+    std::atomic<int64_t> openFiles{0};
+    std::atomic<uint64_t> errors{0};
+};
+
+void raiseMax(std::atomic<uint64_t>& slot, uint64_t v) {
+    uint64_t cur = slot.load();
+    while (v > cur && !slot.compare_exchange_weak(cur, v)) { }
+}
+
+uint64_t nsSince(Clock::time_point t) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t).count());
+}
+}
+
+// never destroyed: flusher threads may still run while statics are torn down
+static std::mutex writersMutex;
+static auto& writers = *new std::unordered_map<std::string, std::shared_ptr<WalWriter>>();
+static Counters counters;
+
+// change stream wake-ups: bumped after every durable run, signalled only
+// while someone waits
+static std::atomic<uint64_t> commitEpochValue{0};
+static std::atomic<int> commitWaiters{0};
+static std::mutex commitMutex;
+static std::condition_variable commitCv;
 
+// Record layout: [tag u8][size u32][crc32c u32][payload], tag = op | flags.
+// The CRC covers tag, size and payload, so a torn or overwritten header is
+// caught as well.
+//   SEQUENCED: payload is [seq u64][body]; body is the MessagePack document
+//              (INSERT/UPDATE, CHECKPOINT info) or the raw key (DELETE)
+//   ENTRY:     body is a whole MessagePack entry written through WAL::log
+// Older files hold JSON text entries: without SEQUENCED, and before
+// checksums also without CHECKSUMMED and the crc field.
+static const uint8_t CHECKSUMMED = 0x80;
+static const uint8_t SEQUENCED = 0x40;
+static const uint8_t ENTRY = 0x20;
+static const uint8_t OP_MASK = 0x1F;
+static const uint32_t MAX_RECORD = 1u << 30;
+
+static WalOp entryOp(const nlohmann::json& entry) {
+    std::string op = entry.is_object() ? entry.value("op", "") : "";
+    if (op == "UPDATE") return WalOp::UPDATE;
+    if (op == "DELETE") return WalOp::DELETE;
+    return WalOp::INSERT;
+}
+
+// Read one segment; false if it stops at a bad record. lastSeq carries the
+// newest sequence number across the segments of a WAL: a recycled segment
+// still holds older records behind the new ones, and those end it. end
+// receives the offset right after the last record taken; without fn the
+// records are only checked, not decoded, and so are those not numbered
+// after `after`.
+static bool readSegment(const std::string& segment, uint64_t& lastSeq,
+                        const std::function<void(WalRecord&)>& fn, uint64_t* end = nullptr,
+                        uint64_t after = 0) {
+    std::ifstream in(segment, std::ios::binary);
+    if (!in.is_open()) return true;
+
+    uint64_t offset = 0;
+    bool sequenced = false;
+    std::string payload;
     while (true) {
-        WalOp op;
+        if (end) *end = offset;
+        uint8_t tag;
         uint32_t size;
 
-        if (!in.read(reinterpret_cast<char*>(&op), sizeof(op))) break;
-        if (!in.read(reinterpret_cast<char*>(&size), sizeof(size))) break;
+        if (!in.read(reinterpret_cast<char*>(&tag), sizeof(tag))) break;   // clean end
+        if (tag == 0) break;        // end marker / preallocated space
+        const char* bad = nullptr;
+        uint32_t crc = 0;
+
+        if (!in.read(reinterpret_cast<char*>(&size), sizeof(size))) bad = "torn header";
+        else if (size > MAX_RECORD) bad = "bad length";
+        else if ((tag & CHECKSUMMED) && !in.read(reinterpret_cast<char*>(&crc), sizeof(crc))) bad = "torn header";
+        else {
+            payload.resize(size);
+            if (size && !in.read(payload.data(), size)) bad = "torn payload";
+        }
+
+        if (!bad && (tag & CHECKSUMMED)) {
+            uint32_t actual = CRC32C::extend(0, &tag, sizeof(tag));
+            actual = CRC32C::extend(actual, &size, sizeof(size));
+            actual = CRC32C::extend(actual, payload.data(), payload.size());
+            if (actual != crc) bad = "checksum mismatch";
+        }
+        if (!bad && (tag & SEQUENCED) && size < sizeof(uint64_t)) bad = "bad length";
+
+        if (bad) {
+            std::cerr << "[WAL] " << bad << " at offset " << offset << " in " << segment
+                      << ", ignoring the rest of the log\n";
+            return false;
+        }
 
-        if (size == 0) continue;
+        if (tag & SEQUENCED) {
+            uint64_t seq;
+            std::memcpy(&seq, payload.data(), sizeof(seq));
+            if (seq <= lastSeq) break;      // left over from the segment's previous life
+            lastSeq = seq;
+            sequenced = true;
+        } else if (sequenced) {
+            break;                          // older format never follows a numbered record
+        }
 
-        std::string payload(size, '\0');
-        if (!in.read(payload.data(), size)) break;
+        offset += sizeof(tag) + sizeof(size) + ((tag & CHECKSUMMED) ? sizeof(crc) : 0) + size;
+        if (size == 0 || !fn) continue;
+        if ((tag & SEQUENCED) ? lastSeq <= after : after > 0) continue;
 
+        WalRecord rec;
+        rec.op = static_cast<WalOp>(tag & OP_MASK);
         try {
-            auto e = nlohmann::json::parse(payload);
-            if (op == WalOp::INSERT) {
-                DatabaseEngine::insert(
-                    e["userId"], e["db"], e["collection"], e["data"]
-                );
+            if (tag & SEQUENCED) {
+                rec.seq = lastSeq;
+                const char* body = payload.data() + sizeof(rec.seq);
+                size_t bodyLen = payload.size() - sizeof(rec.seq);
+
+                if (rec.op == WalOp::DELETE && !(tag & ENTRY)) {
+                    rec.key.assign(body, bodyLen);
+                } else {
+                    rec.doc = nlohmann::json::from_msgpack(body, body + bodyLen);
+                    rec.entry = (tag & ENTRY) != 0;
+                }
+            } else {
+                rec.doc = nlohmann::json::parse(payload);
+                rec.entry = true;
             }
-            // future: handle UPDATE / DELETE
         } catch (const std::exception& ex) {
-            std::cerr << "[WAL] Failed to parse WAL entry: " << ex.what() << "\n";
+            // checksum was fine (or absent), so the record is intact but unreadable
+            std::cerr << "[WAL] Failed to decode WAL entry: " << ex.what() << "\n";
+            continue;
         }
+        fn(rec);
     }
+    if (end) *end = offset;
+    return true;
 }
 
-// Read all WAL entries as JSON objects
-std::vector<std::string> WAL::readAll(const std::string& walFile) {
-    std::ifstream in(walFile, std::ios::binary);
-    std::vector<std::string> entries;
+static bool syncFile(const std::string& file, int fd) {
+    auto t0 = Clock::now();
+    bool ok = syncFd(fd);
+    counters.syncs++;
+    counters.syncNs += nsSince(t0);
+    if (!ok) {
+        counters.errors++;
+        std::cerr << "[WAL] Sync failed: " << file << "\n";
+    }
+    return ok;
+}
 
-    if (!in.is_open()) {
-        std::cout << "[WAL] No WAL file found: " << walFile << "\n";
-        return entries;
+// header [tag][size][crc][seq] then the body already appended behind it
+static const size_t HEADER = 1 + 4 + 4 + 8;
+
+static void beginRecord(std::string& bytes) {
+    bytes.assign(HEADER, '\0');
+}
+
+static void finishRecord(std::string& bytes, uint8_t tag, uint64_t seq) {
+    uint32_t size = static_cast<uint32_t>(bytes.size() - HEADER + sizeof(seq));
+    std::memcpy(&bytes[0], &tag, 1);
+    std::memcpy(&bytes[1], &size, 4);
+    std::memcpy(&bytes[9], &seq, 8);
+
+    uint32_t crc = CRC32C::extend(0, &tag, sizeof(tag));
+    crc = CRC32C::extend(crc, &size, sizeof(size));
+    crc = CRC32C::extend(crc, bytes.data() + 9, bytes.size() - 9);
+    std::memcpy(&bytes[5], &crc, 4);
+}
+
+WalWriter::WalWriter(std::string file) : file(std::move(file)), ring(RING_SLOTS), mask(RING_SLOTS - 1) {
+    for (uint64_t i = 0; i < ring.size(); ++i) ring[i].turn.store(i);
+    scanSegments();
+    flusher = std::thread([this] { flusherLoop(); });
+}
+
+WalWriter::~WalWriter() {
+    stopping = true;
+    {
+        std::lock_guard<std::mutex> lk(m);
+        wake.notify_one();
+    }
+    if (flusher.joinable()) flusher.join();
+    if (block) alignedFree(block);
+}
+
+std::string WalWriter::segmentPath(uint64_t seq, const char* ext) const {
+    char num[32];
+    std::snprintf(num, sizeof(num), "%06llu", static_cast<unsigned long long>(seq));
+    fs::path base(file);
+    return (base.parent_path() / (base.stem().string() + "." + num + ext)).string();
+}
+
+void WalWriter::scanSegments() {
+    auto segs = listSegments(file);
+
+    // numbering continues after the newest record (a checkpoint always
+    // leaves one in the newest segment)
+    uint64_t end = 0;
+    for (auto& seg : segs) {
+        end = 0;
+        readSegment(seg.second.string(), baseSeq, nullptr, &end);
+    }
+
+    // continue the newest segment right after its last good record, over a
+    // torn tail or leftovers; a pre-segment file is only ever read
+    if (!segs.empty() && segs.back().first > 0) {
+        segment = segs.back().first;
+        segmentBytes = end;
+    }
+}
+
+/* ---------------- PRODUCERS (lock-free) ---------------- */
+uint64_t WalWriter::publish(size_t count, const std::function<bool(size_t, std::string&, uint64_t)>& encode,
+                            uint64_t retireBefore) {
+    // one atomic add claims the whole run; tickets are consecutive
+    uint64_t first = reserved.fetch_add(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t ticket = first + i;
+        Slot& slot = ring[ticket & mask];
+
+        // the slot is still in use one lap behind: the ring is full
+        if (slot.turn.load(std::memory_order_acquire) != ticket) {
+            counters.ringFullWaits++;
+            if (sleeping.load()) {
+                std::lock_guard<std::mutex> lk(m);
+                wake.notify_one();
+            }
+            while (slot.turn.load(std::memory_order_acquire) != ticket) std::this_thread::yield();
+        }
+
+        slot.startsSegment = encode(i, slot.bytes, baseSeq + ticket + 1);
+        slot.retireBefore = retireBefore == RETIRE_OWN ? baseSeq + ticket + 1 : retireBefore;
+        slot.turn.store(ticket + 1);    // publish
+    }
+
+    if (sleeping.load()) {
+        std::lock_guard<std::mutex> lk(m);
+        wake.notify_one();
+    }
+    return baseSeq + first + count;
+}
+
+void WalWriter::waitDurable(uint64_t seq) {
+    if (seq <= baseSeq) return;
+    uint64_t need = seq - baseSeq;
+    if (durable.load() >= need) return;
+
+    waiters++;
+    {
+        std::unique_lock<std::mutex> lk(m);
+        durableCv.wait(lk, [&] { return durable.load() >= need; });
+    }
+    waiters--;
+}
+
+uint64_t WalWriter::appendWrites(const std::vector<WalWrite>& writes) {
+    if (writes.empty()) return lastSeq();
+    return publish(writes.size(), [&](size_t i, std::string& bytes, uint64_t seq) {
+        const WalWrite& w = writes[i];
+        beginRecord(bytes);
+        if (w.op == WalOp::DELETE) bytes.append(*w.key);
+        else nlohmann::json::to_msgpack(*w.doc, bytes);
+        finishRecord(bytes, static_cast<uint8_t>(static_cast<uint8_t>(w.op) | CHECKSUMMED | SEQUENCED), seq);
+        return false;
+    });
+}
+
+uint64_t WalWriter::logWrites(const std::vector<WalWrite>& writes) {
+    auto started = Clock::now();
+    uint64_t seq = appendWrites(writes);
+    waitDurable(seq);
+
+    uint64_t ns = nsSince(started);
+    counters.commits++;
+    counters.commitNs += ns;
+    raiseMax(counters.maxCommitNs, ns);
+    return seq;
+}
+
+uint64_t WalWriter::log(const nlohmann::json& entry) {
+    return logBatch({ entry });
+}
+
+uint64_t WalWriter::logBatch(const std::vector<nlohmann::json>& entries) {
+    if (entries.empty()) return lastSeq();
+    auto started = Clock::now();
+
+    uint64_t seq = publish(entries.size(), [&](size_t i, std::string& bytes, uint64_t recSeq) {
+        beginRecord(bytes);
+        nlohmann::json::to_msgpack(entries[i], bytes);
+        finishRecord(bytes, static_cast<uint8_t>(static_cast<uint8_t>(entryOp(entries[i])) | CHECKSUMMED | SEQUENCED | ENTRY), recSeq);
+        return false;
+    });
+    waitDurable(seq);
+
+    uint64_t ns = nsSince(started);
+    counters.commits++;
+    counters.commitNs += ns;
+    raiseMax(counters.maxCommitNs, ns);
+    return seq;
+}
+
+uint64_t WalWriter::checkpoint(const nlohmann::json& info) {
+    uint64_t seq = publish(1, [&](size_t, std::string& bytes, uint64_t recSeq) {
+        beginRecord(bytes);
+        nlohmann::json::to_msgpack(info, bytes);
+        finishRecord(bytes, static_cast<uint8_t>(static_cast<uint8_t>(WalOp::CHECKPOINT) | CHECKSUMMED | SEQUENCED), recSeq);
+        return true;    // the flusher starts a new segment and drops the older ones
+    }, RETIRE_OWN);
+    waitDurable(seq);
+    return seq;
+}
+
+uint64_t WalWriter::rotate() {
+    return publish(1, [&](size_t, std::string& bytes, uint64_t recSeq) {
+        beginRecord(bytes);
+        nlohmann::json::to_msgpack(nlohmann::json{ {"rotate", true} }, bytes);
+        finishRecord(bytes, static_cast<uint8_t>(static_cast<uint8_t>(WalOp::CHECKPOINT) | CHECKSUMMED | SEQUENCED), recSeq);
+        return true;    // new segment, nothing retired yet
+    });
+}
+
+uint64_t WalWriter::checkpoint(const nlohmann::json& info, uint64_t rotation) {
+    return publish(1, [&](size_t, std::string& bytes, uint64_t recSeq) {
+        beginRecord(bytes);
+        nlohmann::json::to_msgpack(info, bytes);
+        finishRecord(bytes, static_cast<uint8_t>(static_cast<uint8_t>(WalOp::CHECKPOINT) | CHECKSUMMED | SEQUENCED), recSeq);
+        return false;   // written wherever the run goes
+    }, rotation);
+}
+
+/* ---------------- FLUSHER ---------------- */
+void WalWriter::openSegment() {
+    std::string path = segmentPath(segment);
+    std::error_code ec;
+    if (!fs::exists(path, ec)) {
+        segmentBytes = 0;
+        // a retired segment has its blocks allocated and written already;
+        // its old records end at the first one not newer than ours
+        auto spares = listSpares(file);
+        if (!spares.empty()) {
+            fs::rename(spares.front(), path, ec);
+            if (!ec) counters.recycled++;
+        }
+    }
+
+    direct = dsync = false;
+    fd = -1;
+    if (IO_MODE == WalIo::DIRECT) {
+        fd = openWrite(path, DIRECT_FLAGS);
+        if (fd >= 0) {
+            direct = dsync = true;
+        } else {
+            static std::once_flag warned;
+            std::call_once(warned, [&] {
+                std::cerr << "[WAL] O_DIRECT not available for " << path << ", using O_DSYNC\n";
+            });
+        }
+    }
+    if (fd < 0 && IO_MODE != WalIo::BUFFERED) {
+        fd = openWrite(path, DSYNC_FLAGS);
+        dsync = fd >= 0;
+    }
+    if (fd < 0) fd = openWrite(path, 0);
+    if (fd < 0) {
+        counters.errors++;
+        std::cerr << "[WAL] Failed to open WAL file: " << path << "\n";
+        return;
+    }
+
+    uint64_t size = static_cast<uint64_t>(fs::file_size(path, ec));
+    if (ec) size = 0;
+    if (PREALLOCATE && size < SEGMENT_BYTES && preallocate(fd, SEGMENT_BYTES)) counters.preallocated++;
+
+    // aligned writes start at the partial block the last record ends in
+    tail.clear();
+    if (direct && segmentBytes % IO_ALIGN) {
+        tail.resize(segmentBytes % IO_ALIGN);
+        std::ifstream in(path, std::ios::binary);
+        in.seekg(static_cast<std::streamoff>(segmentBytes - tail.size()));
+        in.read(tail.data(), static_cast<std::streamsize>(tail.size()));
+    }
+
+    counters.opens++;
+    counters.openFiles++;
+}
+
+// Write the drained run at the end of the segment, followed by a zero tag
+// marking the end for readers (the next run writes over it).
+bool WalWriter::writeRun() {
+    if (!direct) {
+        out.push_back('\0');
+        bool ok = writeAt(fd, out.data(), out.size(), segmentBytes);
+        out.pop_back();
+        return ok;
+    }
+
+    // O_DIRECT: whole blocks from the start of the partial one, zero padded
+    uint64_t start = segmentBytes - tail.size();
+    size_t len = tail.size() + out.size() + 1;
+    size_t padded = (len + IO_ALIGN - 1) / IO_ALIGN * IO_ALIGN;
+    if (padded > blockCap) {
+        if (block) alignedFree(block);
+        blockCap = std::max(padded, blockCap * 2);
+        block = alignedAlloc(blockCap, IO_ALIGN);
+        if (!block) {
+            blockCap = 0;
+            return false;
+        }
     }
+    std::memcpy(block, tail.data(), tail.size());
+    std::memcpy(block + tail.size(), out.data(), out.size());
+    std::memset(block + tail.size() + out.size(), 0, padded - tail.size() - out.size());
+
+    if (!writeAt(fd, block, padded, start)) return false;
+    size_t used = tail.size() + out.size();
+    tail.assign(block + used / IO_ALIGN * IO_ALIGN, used % IO_ALIGN);
+    return true;
+}
+
+void WalWriter::closeSegment() {
+    if (fd < 0) return;
+    if (dirty) syncFile(segmentPath(segment), fd);
+    dirty = false;
+    closeFd(fd);
+    fd = -1;
+    counters.openFiles--;
+}
+
+void WalWriter::flusherLoop() {
+    uint64_t head = 0;
+    long tick = std::min<long>(IDLE_CLOSE_MS, SYNC_POLICY == WalSync::INTERVAL ? SYNC_INTERVAL_MS : 1000L);
 
     while (true) {
-        WalOp op;
-        uint32_t size;
-        if (!in.read(reinterpret_cast<char*>(&op), sizeof(op))) break;
-        if (!in.read(reinterpret_cast<char*>(&size), sizeof(size))) break;
+        if (ring[head & mask].turn.load() != head + 1) {
+            // nothing published: background duties, then sleep
+            auto now = Clock::now();
+            if (dirty && fd >= 0 && now - lastSync >= std::chrono::milliseconds(SYNC_INTERVAL_MS)) {
+                syncFile(segmentPath(segment), fd);
+                dirty = false;
+                lastSync = now;
+            }
+            if (fd >= 0 && now - lastUsed >= std::chrono::milliseconds(IDLE_CLOSE_MS)) {
+                closeSegment();
+                counters.idleCloses++;
+            }
+            if (stopping) break;
+
+            std::unique_lock<std::mutex> lk(m);
+            sleeping = true;
+            if (ring[head & mask].turn.load() != head + 1 && !stopping) {
+                wake.wait_for(lk, std::chrono::milliseconds(tick));
+            }
+            sleeping = false;
+            continue;
+        }
+
+        if (GROUP_COMMIT_US > 0) std::this_thread::sleep_for(std::chrono::microseconds(GROUP_COMMIT_US));
+
+        // drain the contiguous published run
+        out.clear();
+        uint64_t records = 0;
+        bool newSegment = false;
+        uint64_t retireBefore = 0;
+        const uint64_t runSeq = baseSeq + head + 1;
+        while (out.size() < MAX_RUN_BYTES) {
+            Slot& slot = ring[head & mask];
+            if (slot.turn.load(std::memory_order_acquire) != head + 1) break;
+            if (slot.startsSegment) {
+                if (records > 0) break;         // the checkpoint opens the next run
+                newSegment = true;
+            }
+            retireBefore = std::max(retireBefore, slot.retireBefore);
+
+            out.append(slot.bytes);
+            if (slot.bytes.capacity() > (64u << 10)) std::string().swap(slot.bytes);
+            slot.turn.store(head + ring.size(), std::memory_order_release);   // free for the next lap
+            head++;
+            records++;
+        }
 
-        if (size == 0) continue;
+        if (newSegment) {
+            closeSegment();
+            segment++;
+            rotations.push_back({ runSeq, segment });
+        }
 
-        std::string payload(size, '\0');
-        if (!in.read(payload.data(), size)) break;
+        // segments before the one the named record started
+        std::vector<std::pair<uint64_t, fs::path>> obsolete;
+        bool retiring = false;
+        if (retireBefore) {
+            for (auto& r : rotations) {
+                if (r.first != retireBefore) continue;
+                retiring = true;
+                for (auto& seg : listSegments(file)) {
+                    if (seg.first < r.second) obsolete.push_back(seg);
+                }
+            }
+            rotations.erase(std::remove_if(rotations.begin(), rotations.end(),
+                                           [&](const auto& r) { return r.first <= retireBefore; }),
+                            rotations.end());
+        }
+        if (fd < 0) openSegment();
 
-        entries.push_back(payload); // keep as string
+        bool ok = fd >= 0;
+        if (ok) {
+            ok = writeRun();
+            if (!ok) {
+                counters.errors++;
+                std::cerr << "[WAL] Write failed: " << segmentPath(segment) << "\n";
+            }
+            else segmentBytes += out.size();
+        }
+        // an O_DSYNC descriptor made the write durable already
+        if (ok && SYNC_POLICY == WalSync::BATCH && !dsync) ok = syncFile(segmentPath(segment), fd);
+        if (ok && SYNC_POLICY == WalSync::INTERVAL && !dsync) dirty = true;
+        if (!ok && fd >= 0) {
+            // start over with a fresh descriptor next time
+            closeFd(fd);
+            fd = -1;
+            counters.openFiles--;
+        }
+        if (fd >= 0 && segmentBytes >= SEGMENT_BYTES) {
+            // segment full: the next run starts a new one
+            closeSegment();
+            segment++;
+            segmentBytes = 0;
+        }
+
+        if (retiring) {
+            // keep a few full-size segments to write over, drop the rest
+            size_t spares = listSpares(file).size(), kept = 0, removed = 0;
+            for (auto& seg : obsolete) {
+                std::error_code ec;
+                if (PREALLOCATE && seg.first > 0 && spares < static_cast<size_t>(RECYCLE_SEGMENTS)) {
+                    fs::rename(seg.second, segmentPath(seg.first, ".free"), ec);
+                    if (!ec) {
+                        spares++;
+                        kept++;
+                        continue;
+                    }
+                }
+                if (fs::remove(seg.second, ec)) removed++;
+            }
+            std::cout << "[WAL] Checkpoint " << file << " at segment " << segment
+                      << ", retired " << kept + removed << " old segments (" << kept << " kept for reuse)" << std::endl;
+        }
+
+        lastUsed = Clock::now();
+        counters.runs++;
+        counters.records += records;
+        raiseMax(counters.maxRun, records);
+
+        // wake whoever waits on these records
+        durable.store(head);
+        if (waiters.load() > 0) {
+            std::lock_guard<std::mutex> lk(m);
+            durableCv.notify_all();
+        }
+        commitEpochValue++;
+        if (commitWaiters.load() > 0) {
+            std::lock_guard<std::mutex> lk(commitMutex);
+            commitCv.notify_all();
+        }
     }
+    closeSegment();
+}
+
+std::shared_ptr<WalWriter> WAL::writer(const std::string& file) {
+    std::lock_guard<std::mutex> lk(writersMutex);
+    auto& w = writers[file];
+    if (!w) w = std::make_shared<WalWriter>(file);
+    return w;
+}
+
+void WAL::log(const std::string& file, const nlohmann::json& entry) {
+    writer(file)->log(entry);
+}
+
+void WAL::logBatch(const std::string& file, const std::vector<nlohmann::json>& entries) {
+    writer(file)->logBatch(entries);
+}
+
+std::vector<std::string> WAL::segments(const std::string& file) {
+    std::vector<std::string> out;
+    for (auto& [seq, path] : listSegments(file)) out.push_back(path.string());
+    return out;
+}
+
+void WAL::clear(const std::string& file) {
+    writer(file)->checkpoint({ {"clear", true} });
+    std::cout << "[WAL] Cleared " << file << std::endl;
+}
+
+bool WAL::syncPath(const std::string& path) {
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+    if (fd < 0) return false;
+    bool ok = syncFile(path, fd);
+    closeFd(fd);
+    return ok;
+}
+
+nlohmann::json WAL::stats() {
+    const char* policy = SYNC_POLICY == WalSync::NONE ? "none" : SYNC_POLICY == WalSync::BATCH ? "batch" : "interval";
+    const char* io = IO_MODE == WalIo::DIRECT ? "direct" : IO_MODE == WalIo::DSYNC ? "dsync" : "buffered";
+    uint64_t runs = counters.runs, records = counters.records, commits = counters.commits, syncs = counters.syncs;
+    return {
+        {"sync", policy},
+        {"io", io},
+        {"segmentBytes", SEGMENT_BYTES},
+        {"preallocate", PREALLOCATE},
+        {"ringSlots", RING_SLOTS},
+        {"commits", commits},
+        {"groups", runs},
+        {"records", records},
+        {"avgBatchSize", runs ? static_cast<double>(records) / runs : 0.0},
+        {"maxBatchSize", counters.maxRun.load()},
+        {"avgCommitMs", commits ? counters.commitNs / 1e6 / commits : 0.0},
+        {"maxCommitMs", counters.maxCommitNs / 1e6},
+        {"syncs", syncs},
+        {"avgSyncMs", syncs ? counters.syncNs / 1e6 / syncs : 0.0},
+        {"ringFullWaits", counters.ringFullWaits.load()},
+        {"openFiles", counters.openFiles.load()},
+        {"opens", counters.opens.load()},
+        {"preallocated", counters.preallocated.load()},
+        {"recycled", counters.recycled.load()},
+        {"idleCloses", counters.idleCloses.load()},
+        {"errors", counters.errors.load()}
+    };
+}
+
+bool WAL::read(const std::string& file, const std::function<void(WalRecord&)>& fn, uint64_t after) {
+    uint64_t lastSeq = 0;
+    for (const auto& segment : segments(file)) {
+        if (!readSegment(segment, lastSeq, fn, nullptr, after)) return false;
+    }
+    return true;
+}
+
+uint64_t WAL::commitEpoch() {
+    return commitEpochValue.load();
+}
+
+bool WAL::waitCommit(uint64_t epoch, std::chrono::milliseconds timeout) {
+    commitWaiters++;
+    bool changed;
+    {
+        std::unique_lock<std::mutex> lk(commitMutex);
+        changed = commitCv.wait_for(lk, timeout, [&] { return commitEpochValue.load() != epoch; });
+    }
+    commitWaiters--;
+    return changed;
+}
+
+void WAL::replay(const std::string& file) {
+    read(file, [](WalRecord& r) {
+        if (!r.entry || r.op != WalOp::INSERT) return;   // future: handle UPDATE / DELETE
+        try {
+            auto& e = r.doc;
+            DatabaseEngine::insert(
+                e["userId"], e["db"], e["collection"], e["data"]
+            );
+        } catch (const std::exception& ex) {
+            std::cerr << "[WAL] Failed to replay WAL entry: " << ex.what() << "\n";
+        }
+    });
+}
+
+// Read all WAL entries as JSON text; numbered collection records come back
+// as {"op", "seq", "data" | "id"}
+std::vector<std::string> WAL::readAll(const std::string& walFile) {
+    std::vector<std::string> entries;
+
+    if (segments(walFile).empty()) {
+        std::cout << "[WAL] No WAL file found: " << walFile << "\n";
+        return entries;
+    }
+
+    read(walFile, [&](WalRecord& r) {
+        if (r.op == WalOp::CHECKPOINT) return;
+        if (r.entry) {
+            entries.push_back(r.doc.dump());
+        } else if (r.op == WalOp::DELETE) {
+            entries.push_back(json{ {"op", "DELETE"}, {"seq", r.seq}, {"id", r.key} }.dump());
+        } else {
+            entries.push_back(json{ {"op", r.op == WalOp::UPDATE ? "UPDATE" : "PUT"}, {"seq", r.seq}, {"data", std::move(r.doc)} }.dump());
+        }
+    });
 
     std::cout << "[WAL] Read " << entries.size() << " entries\n";
     return entries;
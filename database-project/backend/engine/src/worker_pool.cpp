@@ -0,0 +1,141 @@
+#include "worker_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <memory>
+
+WorkerPool::WorkerPool(size_t threads, size_t maxQueue) : maxQueue(maxQueue) {
+    if (threads == 0) threads = 1;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+    std::cout << "[POOL] Started " << threads << " workers, queue limit "
+              << (maxQueue ? std::to_string(maxQueue) : std::string("none")) << std::endl;
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        tasks.push_back({std::move(task), Clock::now()});
+        if (tasks.size() > peakQueued) peakQueued = tasks.size();
+    }
+    cv.notify_one();
+}
+
+bool WorkerPool::trySubmit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (maxQueue && tasks.size() >= maxQueue) {
+            ++rejected;
+            return false;
+        }
+        tasks.push_back({std::move(task), Clock::now()});
+        if (tasks.size() > peakQueued) peakQueued = tasks.size();
+    }
+    cv.notify_one();
+    return true;
+}
+
+void WorkerPool::stop() {
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (stopping) return;
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& t : workers) {
+        if (t.joinable()) t.join();
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+
+    struct State {
+        std::atomic<size_t> next{0};
+        std::mutex m;
+        std::condition_variable cv;
+        size_t done = 0;
+        std::exception_ptr error;
+    };
+    auto st = std::make_shared<State>();
+
+    // fn is only touched after claiming an item, and the caller does not
+    // return before every claimed item finished, so helpers that start late
+    // never see a dangling reference
+    auto drain = [st, &fn, count] {
+        for (size_t i; (i = st->next.fetch_add(1)) < count; ) {
+            std::exception_ptr err;
+            try {
+                fn(i);
+            } catch (...) {
+                err = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lk(st->m);
+            if (err && !st->error) st->error = err;
+            if (++st->done == count) st->cv.notify_all();
+        }
+    };
+
+    size_t helpers = std::min(count - 1, workers.size());
+    for (size_t h = 0; h < helpers; ++h) submit(drain);
+    drain();
+
+    std::unique_lock<std::mutex> lk(st->m);
+    st->cv.wait(lk, [&] { return st->done == count; });
+    if (st->error) std::rethrow_exception(st->error);
+}
+
+WorkerPool::Stats WorkerPool::stats() {
+    std::lock_guard<std::mutex> lk(mtx);
+    Stats s;
+    s.threads = workers.size();
+    s.queued = tasks.size();
+    s.peakQueued = peakQueued;
+    s.active = active;
+    s.maxQueue = maxQueue;
+    s.completed = completed;
+    s.rejected = rejected;
+    s.avgWaitMs = started ? totalWaitMs / static_cast<double>(started) : 0.0;
+    s.maxWaitMs = maxWaitMs;
+    return s;
+}
+
+void WorkerPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lk(mtx);
+            cv.wait(lk, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+
+            Task t = std::move(tasks.front());
+            tasks.pop_front();
+            task = std::move(t.fn);
+
+            double waitMs = std::chrono::duration<double, std::milli>(Clock::now() - t.enqueued).count();
+            totalWaitMs += waitMs;
+            if (waitMs > maxWaitMs) maxWaitMs = waitMs;
+            ++started;
+            ++active;
+        }
+
+        try {
+            task();
+        } catch (const std::exception& ex) {
+            std::cerr << "[POOL] Task failed: " << ex.what() << std::endl;
+        } catch (...) {
+            std::cerr << "[POOL] Task failed with unknown error" << std::endl;
+        }
+
+        std::lock_guard<std::mutex> lk(mtx);
+        --active;
+        ++completed;
+    }
+}
@@ -1,44 +1,129 @@
 const net = require("net");
 
-function sendCommand(payload) {
-  return new Promise((resolve, reject) => {
-    const client = new net.Socket();
-    let buffer = "";
+const ENGINE_HOST = process.env.ENGINE_HOST || "127.0.0.1";
+const ENGINE_PORT = parseInt(process.env.ENGINE_PORT || "9000", 10);
+const POOL_SIZE = parseInt(process.env.ENGINE_POOL_SIZE || "4", 10);
+// same-host deployments can point this at the engine's unix domain socket
+// (e.g. /tmp/db_engine.sock) to skip the loopback TCP stack
+const ENGINE_SOCKET = process.env.ENGINE_SOCKET || "";
 
-    client.connect(9000, "127.0.0.1", () => {
-      client.write(JSON.stringify(payload));
-    });
+// Engine wire format: [uint32 big-endian length][JSON payload] per message.
+// Connections stay open; every request carries a requestId and the engine
+// echoes it back, so many requests can be in flight on one socket and their
+// responses may arrive in any order.
+function encodeFrame(payload) {
+  const body = Buffer.from(JSON.stringify(payload));
+  const header = Buffer.alloc(4);
+  header.writeUInt32BE(body.length, 0);
+  return Buffer.concat([header, body]);
+}
 
-    client.on("data", chunk => {
-      buffer += chunk.toString();
-    });
+function normalize(response) {
+  // ✅ normalize response
+  if (Array.isArray(response)) {
+    return response;
+  }
 
-    client.on("end", () => {
-      try {
-        const response = JSON.parse(buffer);
+  // cursor replies (find with batchSize, getMore) keep cursorId/hasMore
+  if (response?.status === "ok" && Array.isArray(response.data) && !("cursorId" in response)) {
+    return response.data;
+  }
 
-        // ✅ normalize response
-        if (Array.isArray(response)) {
-          return resolve(response);
-        }
+  // if it's an object with status/message, return it as-is
+  if (response && typeof response === "object") {
+    return response;
+  }
 
-        if (response?.status === "ok" && Array.isArray(response.data)) {
-          return resolve(response.data);
-        }
+  return [];
+}
+
+class EngineConnection {
+  constructor() {
+    this.socket = null;
+    this.buffer = Buffer.alloc(0);
+    this.pending = new Map();
+    this.nextId = 1;
+  }
+
+  open() {
+    const socket = new net.Socket();
+    if (ENGINE_SOCKET) {
+      socket.connect(ENGINE_SOCKET);
+    } else {
+      socket.setNoDelay(true);
+      socket.connect(ENGINE_PORT, ENGINE_HOST);
+    }
+
+    socket.on("data", chunk => {
+      this.buffer = this.buffer.length ? Buffer.concat([this.buffer, chunk]) : chunk;
+
+      while (this.buffer.length >= 4) {
+        const len = this.buffer.readUInt32BE(0);
+        if (this.buffer.length < 4 + len) break;
+
+        const body = this.buffer.toString("utf8", 4, 4 + len);
+        this.buffer = this.buffer.subarray(4 + len);
 
-        // if it's an object with status/message, return it as-is
-        if (response && typeof response === "object") {
-          return resolve(response);
+        let response;
+        try {
+          response = JSON.parse(body);
+        } catch (err) {
+          continue; // cannot tell which request it belongs to
         }
 
-        resolve([]);
-      } catch (err) {
-        reject("Invalid engine response: " + err.message);
+        const id = response && response.requestId;
+        const waiter = this.pending.get(id);
+        if (!waiter) continue;
+        this.pending.delete(id);
+        delete response.requestId;
+
+        // an idle pooled connection must not keep the process alive
+        if (!this.pending.size) socket.unref();
+        waiter.resolve(normalize(response));
       }
     });
 
-    client.on("error", err => reject(err.message));
-  });
+    const fail = reason => {
+      if (this.socket !== socket) return;
+      this.socket = null;
+      this.buffer = Buffer.alloc(0);
+      const waiting = this.pending;
+      this.pending = new Map();
+      waiting.forEach(w => w.reject(reason));
+    };
+
+    socket.on("error", err => fail(err.message));
+    socket.on("close", () => fail("engine connection closed"));
+
+    this.socket = socket;
+  }
+
+  send(payload) {
+    return new Promise((resolve, reject) => {
+      if (!this.socket) this.open();
+      this.socket.ref();
+      const requestId = this.nextId++;
+      this.pending.set(requestId, { resolve, reject });
+      this.socket.write(encodeFrame({ ...payload, requestId }));
+    });
+  }
+}
+
+const pool = Array.from({ length: Math.max(1, POOL_SIZE) }, () => new EngineConnection());
+
+function sendCommand(payload) {
+  // least busy persistent connection
+  let conn = pool[0];
+  for (const c of pool) {
+    if (c.pending.size < conn.pending.size) conn = c;
+  }
+  return conn.send(payload);
+}
+
+function close() {
+  pool.forEach(c => c.socket && c.socket.end());
 }
 
-module.exports = { sendCommand };
+// ENGINE_ADDON=<path to db_engine_addon.node> runs the engine in this process
+// instead (see engineNative.js); no engine server is needed then
+module.exports = process.env.ENGINE_ADDON ? require("./engineNative") : { sendCommand, close };
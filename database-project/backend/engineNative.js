@@ -0,0 +1,42 @@
+const path = require("path");
+
+// In-process engine: loads db_engine_addon.node (engine built with
+// -DBUILD_NODE_ADDON=ON) and serves sendCommand() without the engine server.
+// Resolved values match what engineClient returns for the same payload.
+// Enabled from engineClient.js by setting ENGINE_ADDON to the addon path.
+const ADDON_PATH = path.resolve(process.env.ENGINE_ADDON || path.join(__dirname, "engine/build/db_engine_addon.node"));
+const DATA_ROOT = process.env.ENGINE_DATA_ROOT || path.join(__dirname, "../data");
+
+const addon = require(ADDON_PATH);
+addon.init(DATA_ROOT);
+
+const ACTIONS = {
+  insert: addon.insert,
+  insertVector: addon.insertVector,
+  find: addon.find,
+  queryVector: addon.queryVector,
+  updateOne: addon.updateOne,
+  deleteOne: addon.deleteOne,
+  watch: addon.watch,
+  initUserSpace: addon.initUserSpace,
+  createDatabase: addon.createDatabase,
+  createCollection: addon.createCollection,
+  listDatabases: addon.listDatabases,
+};
+
+async function sendCommand(payload) {
+  if (payload.action === "ping") return { status: "pong" };
+
+  const call = ACTIONS[payload.action];
+  if (!call) return { error: `action not supported in-process: ${payload.action}` };
+
+  try {
+    return await call(payload);
+  } catch (err) {
+    return { error: err.message };
+  }
+}
+
+function close() {}
+
+module.exports = { sendCommand, close };